@@ -0,0 +1,36 @@
+#include "AsyncMPU9250.h"
+
+AsyncMPU9250::AsyncMPU9250(Reactor& reactor, MPU9250& imu, uint32_t batchPeriodUs, int intFd)
+    : _reactor(reactor), _imu(imu), _batchPeriodUs(batchPeriodUs), _intFd(intFd) {
+    _imu.enableFifo();
+    _nextUs = Reactor::now() + _batchPeriodUs;
+}
+
+void AsyncMPU9250::BatchAwaiter::await_suspend(std::coroutine_handle<> h) {
+    if (owner._intFd >= 0) {
+        owner._reactor.resumeWhenReadable(owner._intFd, h);
+    } else {
+        owner._reactor.resumeAt(owner._nextUs, h);
+    }
+}
+
+ImuBatch AsyncMPU9250::BatchAwaiter::await_resume() {
+    uint64_t now = Reactor::now();
+
+    if (owner._intFd >= 0) {
+        // Consume the edge event and clear the latched interrupt
+        owner._reactor.gpioEdge(owner._intFd).await_resume();
+        owner._imu.getInterruptStatus();
+    } else {
+        owner._nextUs += owner._batchPeriodUs;
+        if (owner._nextUs <= now) {
+            owner._nextUs = now + owner._batchPeriodUs; // Fell behind: don't fire back to back
+        }
+    }
+
+    ImuBatch batch;
+    batch.samples = owner._buffer;
+    batch.count = owner._imu.readFifo(owner._buffer, MPU9250::FIFO_MAX_SAMPLES);
+    batch.timestampUs = now;
+    return batch;
+}
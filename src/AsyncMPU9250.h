@@ -0,0 +1,52 @@
+#ifndef ASYNC_MPU9250_H
+#define ASYNC_MPU9250_H
+
+#include "MPU9250.h"
+#include "Reactor.h"
+
+// Samples drained from the FIFO by one AsyncMPU9250::nextBatch(). Valid until the next call.
+struct ImuBatch {
+    const ImuSample* samples;
+    int count;
+    uint64_t timestampUs; // Reactor::now() when the FIFO was drained
+};
+
+// Delivers FIFO batches to coroutines running on a Reactor, so one thread can
+// service the IMU alongside motors and other I/O.
+//
+// nextBatch() drains the FIFO with ordinary blocking bus reads on the loop
+// thread, so every other coroutine waits for the transfer. Keep batches short
+// enough for the tightest deadline on the loop: use SPI at kHz rates, where a
+// full drain takes well under a millisecond, rather than I2C.
+class AsyncMPU9250 {
+public:
+    /**
+     * @param reactor Event loop the awaiting coroutines run on.
+     * @param imu An initialized MPU9250. Its FIFO is enabled here.
+     * @param batchPeriodUs How often the FIFO is drained. Must be shorter than the
+     *        time the FIFO takes to fill (MPU9250::FIFO_MAX_SAMPLES samples).
+     * @param intFd Optional edge fd for the INT pin from Reactor::openGpioEdge().
+     *        When given, batches follow the interrupt instead of the timer; with
+     *        data-ready interrupts that means one wake-up per sample, so prefer the
+     *        timer at kHz rates.
+     */
+    AsyncMPU9250(Reactor& reactor, MPU9250& imu, uint32_t batchPeriodUs, int intFd = -1);
+
+    struct BatchAwaiter {
+        AsyncMPU9250& owner;
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        ImuBatch await_resume();
+    };
+    BatchAwaiter nextBatch() { return BatchAwaiter{*this}; }
+
+private:
+    Reactor& _reactor;
+    MPU9250& _imu;
+    uint32_t _batchPeriodUs;
+    int _intFd;
+    uint64_t _nextUs;
+    ImuSample _buffer[MPU9250::FIFO_MAX_SAMPLES];
+};
+
+#endif // ASYNC_MPU9250_H
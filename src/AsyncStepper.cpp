@@ -0,0 +1,16 @@
+#include "AsyncStepper.h"
+
+Task stepAsync(Reactor& reactor, ULN2003Stepper& stepper, int steps) {
+    int steps_left = steps > 0 ? steps : -steps;
+
+    // Absolute deadlines so time spent servicing other devices doesn't accumulate as drift
+    uint64_t next = Reactor::now();
+    while (steps_left > 0) {
+        if (!stepper.stepOnce(steps)) {
+            break;
+        }
+        next += stepper.getStepDelay();
+        co_await reactor.sleepUntil(next);
+        steps_left--;
+    }
+}
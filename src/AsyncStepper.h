@@ -0,0 +1,17 @@
+#ifndef ASYNC_STEPPER_H
+#define ASYNC_STEPPER_H
+
+#include "Reactor.h"
+#include "Stepper.h"
+
+/**
+ * @brief Moves the motor a number of steps, pacing them with reactor timers
+ *        instead of blocking the thread in delayMicroseconds(). Ends early
+ *        if the stepper's step listener stops the move.
+ * @param reactor Event loop the coroutine runs on.
+ * @param stepper Motor to drive. Must outlive the returned task.
+ * @param steps The number of steps to move. Positive for forward, negative for backward.
+ */
+Task stepAsync(Reactor& reactor, ULN2003Stepper& stepper, int steps);
+
+#endif // ASYNC_STEPPER_H
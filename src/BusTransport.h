@@ -0,0 +1,22 @@
+#ifndef BUS_TRANSPORT_H
+#define BUS_TRANSPORT_H
+
+#include <stdint.h>
+
+// Byte-level access to the bus the MPU9250 sits on. The driver talks to the
+// hardware through wiringPi and spidev unless a transport is installed with
+// MPU9250::setTransport(), which lets a simulated device (SimulatedMPU9250)
+// stand in for the real one on either bus.
+class BusTransport {
+public:
+    virtual ~BusTransport() {}
+
+    // SPI: full duplex in place, buf is sent and overwritten with the received bytes
+    virtual void spiTransfer(uint8_t* buf, uint8_t len, uint32_t speedHz) = 0;
+
+    // I2C: single register access on the device at a 7-bit address
+    virtual uint8_t i2cRead(uint8_t address, uint8_t reg) = 0;
+    virtual void i2cWrite(uint8_t address, uint8_t reg, uint8_t data) = 0;
+};
+
+#endif // BUS_TRANSPORT_H
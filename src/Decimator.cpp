@@ -0,0 +1,115 @@
+#include "Decimator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// out[0..7] = sum over k of taps[k] * frames[k][0..7]
+static void dotFrames(const float* taps, const float* frames, int numTaps, float* out) {
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int k = 0; k < numTaps; k++) {
+        float32x4_t h = vdupq_n_f32(taps[k]);
+        acc0 = vmlaq_f32(acc0, vld1q_f32(frames + 8 * k), h);
+        acc1 = vmlaq_f32(acc1, vld1q_f32(frames + 8 * k + 4), h);
+    }
+    vst1q_f32(out, acc0);
+    vst1q_f32(out + 4, acc1);
+#elif defined(__SSE__)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int k = 0; k < numTaps; k++) {
+        __m128 h = _mm_set1_ps(taps[k]);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(frames + 8 * k), h));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(frames + 8 * k + 4), h));
+    }
+    _mm_storeu_ps(out, acc0);
+    _mm_storeu_ps(out + 4, acc1);
+#else
+    float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int k = 0; k < numTaps; k++) {
+        for (int lane = 0; lane < 8; lane++) {
+            acc[lane] += taps[k] * frames[8 * k + lane];
+        }
+    }
+    memcpy(out, acc, sizeof(acc));
+#endif
+}
+
+Decimator::Decimator(int ratio, float inputRateHz, float cutoffHz, int tapsPerPhase) {
+    _ratio = ratio < 1 ? 1 : ratio;
+    _inputRateHz = inputRateHz;
+    _numTaps = _ratio * (tapsPerPhase < 1 ? 1 : tapsPerPhase);
+
+    if (cutoffHz <= 0.0f) {
+        // A Blackman window's transition band spans about 5.5 / numTaps of the input
+        // rate, i.e. 5.5 / tapsPerPhase of the output rate; center it so it ends at
+        // the output Nyquist frequency
+        float outputRateHz = _inputRateHz / _ratio;
+        float fraction = 0.5f - 2.75f / (_numTaps / _ratio);
+        cutoffHz = outputRateHz * ((fraction > 0.05f) ? fraction : 0.05f);
+    }
+    float fc = cutoffHz / _inputRateHz; // Normalized to the input rate
+
+    // Blackman-windowed sinc, normalized to unity gain at DC
+    std::vector<float> h(_numTaps);
+    float sum = 0.0f;
+    float center = (_numTaps - 1) / 2.0f;
+    for (int n = 0; n < _numTaps; n++) {
+        float m = n - center;
+        float sinc = (m == 0.0f) ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * m) / ((float)M_PI * m);
+        float window = (_numTaps > 1)
+            ? 0.42f - 0.5f * cosf(2.0f * (float)M_PI * n / (_numTaps - 1))
+                    + 0.08f * cosf(4.0f * (float)M_PI * n / (_numTaps - 1))
+            : 1.0f;
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+
+    _taps.resize(_numTaps);
+    for (int n = 0; n < _numTaps; n++) {
+        _taps[n] = h[_numTaps - 1 - n] / sum;
+    }
+
+    _history.assign(2 * _numTaps * LANES, 0.0f);
+}
+
+void Decimator::reset() {
+    std::fill(_history.begin(), _history.end(), 0.0f);
+    _pos = 0;
+    _phase = 0;
+}
+
+int Decimator::process(const ImuSample* in, int count, ImuSample* out) {
+    int written = 0;
+    for (int i = 0; i < count; i++) {
+        // Every input lands in the shared delay line; writing it twice keeps
+        // the newest _numTaps frames contiguous for the dot product.
+        float frame[LANES] = {in[i].ax, in[i].ay, in[i].az, in[i].gx, in[i].gy, in[i].gz, 0.0f, 0.0f};
+        memcpy(&_history[_pos * LANES], frame, sizeof(frame));
+        memcpy(&_history[(_pos + _numTaps) * LANES], frame, sizeof(frame));
+        _pos = (_pos + 1) % _numTaps;
+
+        if (++_phase < _ratio) {
+            continue;
+        }
+        _phase = 0;
+
+        float acc[LANES];
+        dotFrames(&_taps[0], &_history[_pos * LANES], _numTaps, acc);
+        ImuSample& s = out[written++];
+        s.ax = acc[0];
+        s.ay = acc[1];
+        s.az = acc[2];
+        s.gx = acc[3];
+        s.gy = acc[4];
+        s.gz = acc[5];
+    }
+    return written;
+}
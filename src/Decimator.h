@@ -0,0 +1,58 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include "MPU9250.h"
+#include <vector>
+
+// Streaming anti-aliasing decimator for accel + gyro batches.
+//
+// A direct-form low-pass FIR of ratio * tapsPerPhase taps runs over a delay line
+// that every input enters, but is only evaluated at output instants: each input
+// sample costs tapsPerPhase multiply-adds per axis instead of the full filter
+// length. All six axes are filtered together in one SIMD lane group (NEON on the
+// Pi, SSE on x86, scalar elsewhere).
+//
+// The default design puts the stopband (about -75 dB, Blackman window) at the
+// output Nyquist frequency, so nothing folds back into the output band. The price
+// is the transition band below it: with 24 taps per phase the response is flat
+// to about a quarter of the output rate and -6 dB at 0.39 of it. Fewer taps widen
+// the transition band and lower the cutoff with it.
+class Decimator {
+public:
+    /**
+     * @param ratio Decimation factor M: one output for every M inputs.
+     * @param inputRateHz Sample rate of the incoming stream.
+     * @param cutoffHz Frequency of the -6 dB point. 0 places it half a transition
+     *        band below the output Nyquist frequency, where the stopband starts.
+     * @param tapsPerPhase Filter taps per output interval; more taps give a sharper cutoff.
+     */
+    Decimator(int ratio, float inputRateHz, float cutoffHz = 0.0f, int tapsPerPhase = 24);
+
+    /**
+     * @brief Filters and decimates a batch. State carries over between calls, so
+     *        batches of any size can be fed in.
+     * @param in Input samples.
+     * @param count Number of input samples.
+     * @param out Destination; must hold at least count / ratio + 1 samples.
+     * @return The number of samples written to out.
+     */
+    int process(const ImuSample* in, int count, ImuSample* out);
+
+    void reset(); // Clears the delay line
+
+    int getRatio() const { return _ratio; }
+    float getOutputRate() const { return _inputRateHz / _ratio; }
+
+private:
+    static const int LANES = 8; // 6 axes padded to two 4-wide vectors
+
+    int _ratio;
+    int _numTaps;
+    float _inputRateHz;
+    std::vector<float> _taps;    // Time-reversed so the newest sample meets the last tap
+    std::vector<float> _history; // Delay line of LANES-wide frames, stored twice for contiguous reads
+    int _pos = 0;                // Next frame slot in the delay line
+    int _phase = 0;              // Inputs since the last output
+};
+
+#endif // DECIMATOR_H
@@ -1,10 +1,21 @@
 #include "MPU9250.h"
+#include "TempCompensation.h"
+#include "BusTransport.h"
 #include <wiringPi.h>
 #include <wiringPiI2C.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <cstring>
 #include <iostream>
 #include <unistd.h>
 #include <cmath>
 
+// The MPU9250 accepts SPI up to 1 MHz for all registers, and up to 20 MHz
+// for reading the sensor and interrupt registers only.
+static const uint32_t SPI_CONFIG_SPEED_HZ = 1000000;
+static const uint32_t SPI_DATA_SPEED_HZ   = 20000000;
+
 // ---- Public Methods ----
 
 MPU9250::MPU9250() {
@@ -12,32 +23,57 @@ MPU9250::MPU9250() {
     // Initialization is handled by the init() method.
 }
 
-bool MPU9250::init(Ascale ascale, Gscale gscale, Mscale mscale, Mmode mmode) {
+bool MPU9250::init(Ascale ascale, Gscale gscale, Mscale mscale, Mmode mmode, Bus bus, int spiChannel) {
     // Store the configuration
     _ascale = ascale;
     _gscale = gscale;
     _mscale = mscale;
     _mmode = mmode;
+    _bus = bus;
+
+    if (_transport) {
+        // Simulated device: the pseudo file descriptors are the devices' I2C addresses.
+        // It needs no wiringPiSetup(), so simulated devices can be set up from any thread.
+        _mpu_fd = MPU9250_ADDRESS;
+        _mag_fd = AK8963_ADDRESS;
+        if (_bus == BUS_SPI) {
+            enableAuxMaster();
+        } else {
+            writeByte(_mpu_fd, INT_PIN_CFG, 0x02);
+        }
+    } else if (_bus == BUS_SPI) {
+        wiringPiSetup();
 
-    // Initialize wiringPi and I2C communication
-    wiringPiSetup();
-    _mpu_fd = wiringPiI2CSetup(MPU9250_ADDRESS);
+        // Initialize SPI communication
+        if (!openSPI(spiChannel)) {
+            std::cerr << "ERROR: Failed to initialize SPI for MPU9250." << std::endl;
+            return false;
+        }
 
-    if (_mpu_fd == -1) {
-        std::cerr << "ERROR: Failed to initialize I2C for MPU9250." << std::endl;
-        return false;
-    }
+        // The AK8963 is not on the SPI bus; reach it through the auxiliary I2C master.
+        enableAuxMaster();
+    } else {
+        wiringPiSetup();
 
-    // Enable I2C Bypass Mode to access the AK8963 magnetometer.
-    // This makes the AK8963 visible on the main I2C bus.
-    writeByte(_mpu_fd, INT_PIN_CFG, 0x02);
-    delay(10); // Wait for the bypass to activate
+        // Initialize I2C communication
+        _mpu_fd = wiringPiI2CSetup(MPU9250_ADDRESS);
 
-    _mag_fd = wiringPiI2CSetup(AK8963_ADDRESS);
+        if (_mpu_fd == -1) {
+            std::cerr << "ERROR: Failed to initialize I2C for MPU9250." << std::endl;
+            return false;
+        }
 
-    if (_mag_fd == -1) {
-        std::cerr << "ERROR: Failed to initialize I2C for AK8963." << std::endl;
-        return false;
+        // Enable I2C Bypass Mode to access the AK8963 magnetometer.
+        // This makes the AK8963 visible on the main I2C bus.
+        writeByte(_mpu_fd, INT_PIN_CFG, 0x02);
+        delay(10); // Wait for the bypass to activate
+
+        _mag_fd = wiringPiI2CSetup(AK8963_ADDRESS);
+
+        if (_mag_fd == -1) {
+            std::cerr << "ERROR: Failed to initialize I2C for AK8963." << std::endl;
+            return false;
+        }
     }
 
     // Verify sensor connection
@@ -69,7 +105,7 @@ bool MPU9250::whoAmI() {
         std::cerr << "ERROR: MPU9250 WHO_AM_I check failed. Expected 0x71 or 0x73, got 0x" << std::hex << (int)mpu_id << std::dec << std::endl;
     }
 
-    uint8_t mag_id = readByte(_mag_fd, AK8963_WHO_AM_I);
+    uint8_t mag_id = readMagByte(AK8963_WHO_AM_I);
     bool mag_ok = (mag_id == 0x48);
     if (!mag_ok) {
         std::cerr << "ERROR: AK8963 WHO_AM_I check failed. Expected 0x48, got 0x" << std::hex << (int)mag_id << std::dec << std::endl;
@@ -82,40 +118,207 @@ void MPU9250::reset() {
     // Reset MPU9250
     writeByte(_mpu_fd, PWR_MGMT_1, 0x80);
     delay(100);
+
+    // The reset also disables the auxiliary I2C master needed to reach the AK8963 over SPI
+    if (_bus == BUS_SPI) {
+        enableAuxMaster();
+    }
     
     // Reset AK8963
-    writeByte(_mag_fd, AK8963_CNTL2, 0x01);
+    writeMagByte(AK8963_CNTL2, 0x01);
     delay(100);
 }
 
 void MPU9250::update() {
-    int16_t rawData[3];
-    
-    // Read accelerometer data
-    readAccelData(rawData);
-    ax = (float)rawData[0] * _aRes - accelBias[0];
-    ay = (float)rawData[1] * _aRes - accelBias[1];
-    az = (float)rawData[2] * _aRes - accelBias[2];
-
-    // Read gyroscope data
-    readGyroData(rawData);
-    gx = (float)rawData[0] * _gRes - gyroBias[0];
-    gy = (float)rawData[1] * _gRes - gyroBias[1];
-    gz = (float)rawData[2] * _gRes - gyroBias[2];
-
-    // Read magnetometer data
-    readMagData(rawData);
-    mx = (float)rawData[0] * _mRes * magCalibration[0] - magBias[0];
-    my = (float)rawData[1] * _mRes * magCalibration[1] - magBias[1];
-    mz = (float)rawData[2] * _mRes * magCalibration[2] - magBias[2];
-    
+    updateRaw();
+
+    if (accelFresh) {
+        ax = (float)raw.accel[0] * _aRes - _accelBiasNow[0];
+        ay = (float)raw.accel[1] * _aRes - _accelBiasNow[1];
+        az = (float)raw.accel[2] * _aRes - _accelBiasNow[2];
+    }
+    if (gyroFresh) {
+        gx = (float)raw.gyro[0] * _gRes - _gyroBiasNow[0];
+        gy = (float)raw.gyro[1] * _gRes - _gyroBiasNow[1];
+        gz = (float)raw.gyro[2] * _gRes - _gyroBiasNow[2];
+    }
+
+    if (magFresh) {
+        mx = magMg(0);
+        my = magMg(1);
+        mz = magMg(2);
+    }
+}
+
+void MPU9250::updateRaw() {
+    int16_t rawData[7];
+    uint32_t now = micros();
+
+    bool accelDue = isDue(_accelSched, now);
+    bool gyroDue = isDue(_gyroSched, now);
+    bool tempDue = isDue(_tempSched, now);
+    accelFresh = false;
+    gyroFresh = false;
+    tempFresh = false;
+
+    if (accelDue && gyroDue) {
+        // Accel, temperature and gyro registers are contiguous: one burst beats two reads
+        readAccelTempGyroData(rawData);
+        raw.accel[0] = rawData[0];
+        raw.accel[1] = rawData[1];
+        raw.accel[2] = rawData[2];
+        raw.gyro[0] = rawData[4];
+        raw.gyro[1] = rawData[5];
+        raw.gyro[2] = rawData[6];
+        accelFresh = true;
+        gyroFresh = true;
+        // The temperature comes along for free, unless its channel is off
+        if (_tempSched.periodUs != CHANNEL_OFF) {
+            raw.temp = rawData[3];
+            tempFresh = true;
+        }
+    } else if (accelDue) {
+        // Read accelerometer data
+        readAccelData(raw.accel);
+        accelFresh = true;
+    } else if (gyroDue) {
+        // Read gyroscope data
+        readGyroData(raw.gyro);
+        gyroFresh = true;
+    }
+
     // Read temperature data
-    temperature = ((float)readTempData()) / 333.87f + 21.0f;
+    if (tempDue && !tempFresh) {
+        raw.temp = readTempData();
+        tempFresh = true;
+    }
+
+    // Read magnetometer data only when a new sample is due; otherwise hold the last values
+    magFresh = false;
+    if (_magSched.periodUs != CHANNEL_OFF && (int32_t)(now - _magSched.nextUs) >= 0) {
+        uint32_t period = _magSched.periodUs;
+        if (!readMagData(raw.mag)) {
+            _magWaited = true; // Polled at or after the due time and found nothing
+        } else {
+            magFresh = true;
+            if (period == _magOutputUs) {
+                // Track the sensor's output phase, not the loop's. A sample that had to
+                // be waited for just became ready: resync to now. One found waiting may
+                // have been ready for a while: creep earlier until a poll comes up empty.
+                // Either way aim slightly early, so the loop's lateness never adds up.
+                _magSched.nextUs = (_magWaited ? now : _magSched.nextUs) + period - period / 8;
+            } else {
+                _magSched.nextUs += period;
+            }
+            if ((int32_t)(now - _magSched.nextUs) >= 0) {
+                _magSched.nextUs = now + period; // Fell behind: the loop is slower than the sensor
+            }
+            _magWaited = false;
+
+            // On SPI, SLV0 reads ST2 on every cycle and clears DOR before the mirror is
+            // read: count a miss when more than an output period passed since the last sample
+            if (_bus == BUS_SPI && period == _magOutputUs && _magOutputUs != 0) {
+                if (_magTaken && now - _magTakenUs >= _magOutputUs + _magOutputUs / 2) {
+                    magMissedCount++;
+                }
+                _magTaken = true;
+                _magTakenUs = now;
+            }
+        }
+    }
+
+    if (tempFresh) {
+        temperature = temperatureC();
+    }
+
+    // Let the temperature model learn from the uncompensated sample
+    if (_tempComp && accelFresh && gyroFresh) {
+        float accel[3] = {(float)raw.accel[0] * _aRes, (float)raw.accel[1] * _aRes, (float)raw.accel[2] * _aRes};
+        float gyro[3] = {(float)raw.gyro[0] * _gRes, (float)raw.gyro[1] * _gRes, (float)raw.gyro[2] * _gRes};
+        _tempComp->learn(accel, gyro, temperature);
+    }
+
+    // One bias lookup per update, shared by update() and the accessors
+    currentBias(_accelBiasNow, _gyroBiasNow);
+}
+
+float MPU9250::accelG(int axis) {
+    return (float)raw.accel[axis] * _aRes - _accelBiasNow[axis];
+}
+
+float MPU9250::gyroDps(int axis) {
+    return (float)raw.gyro[axis] * _gRes - _gyroBiasNow[axis];
+}
+
+float MPU9250::magMg(int axis) {
+    return (float)raw.mag[axis] * _mRes * magCalibration[axis] - magBias[axis];
+}
+
+float MPU9250::temperatureC() {
+    return ((float)raw.temp) / 333.87f + 21.0f;
+}
+
+int16_t MPU9250::accelThresholdRaw(int axis, float g) {
+    float counts = roundf((g + _accelBiasNow[axis]) / _aRes);
+    if (counts > 32767.0f) return 32767;
+    if (counts < -32768.0f) return -32768;
+    return (int16_t)counts;
+}
+
+int16_t MPU9250::gyroThresholdRaw(int axis, float dps) {
+    float counts = roundf((dps + _gyroBiasNow[axis]) / _gRes);
+    if (counts > 32767.0f) return 32767;
+    if (counts < -32768.0f) return -32768;
+    return (int16_t)counts;
+}
+
+void MPU9250::setOutputDataRate(GyroDLPF gyroDlpf, AccelDLPF accelDlpf, uint8_t sampleRateDiv) {
+    _gyroDlpf = gyroDlpf;
+    _accelDlpf = accelDlpf;
+    _sampleRateDiv = sampleRateDiv;
+    if (_mpu_fd != -1) {
+        applyOutputDataRate();
+    }
+}
+
+float MPU9250::getGyroSampleRate() {
+    if (_gyroDlpf & 0x18) {
+        return 32000.0f; // FCHOICE bypass
+    }
+    if (_gyroDlpf == GYRO_DLPF_250HZ || _gyroDlpf == GYRO_DLPF_3600HZ) {
+        return 8000.0f;  // SMPLRT_DIV is ignored
+    }
+    return 1000.0f / (1 + _sampleRateDiv);
+}
+
+float MPU9250::getAccelSampleRate() {
+    if (_accelDlpf & 0x08) {
+        return 4000.0f; // ACCEL_FCHOICE bypass
+    }
+    float gyroRate = getGyroSampleRate();
+    return (gyroRate < 1000.0f) ? gyroRate : 1000.0f;
+}
+
+void MPU9250::setChannelRates(float accelHz, float gyroHz, float magHz, float tempHz) {
+    uint32_t now = micros();
+    _accelSched.periodUs = (accelHz > 0) ? (uint32_t)(1e6f / accelHz) : (accelHz < 0) ? CHANNEL_OFF : 0;
+    _gyroSched.periodUs  = (gyroHz > 0)  ? (uint32_t)(1e6f / gyroHz)  : (gyroHz < 0)  ? CHANNEL_OFF : 0;
+    _tempSched.periodUs  = (tempHz > 0)  ? (uint32_t)(1e6f / tempHz)  : (tempHz < 0)  ? CHANNEL_OFF : 0;
+    _magRequestedUs      = (magHz > 0)   ? (uint32_t)(1e6f / magHz)   : (magHz < 0)   ? CHANNEL_OFF : 0;
+    _magSched.periodUs = (_magRequestedUs > _magOutputUs) ? _magRequestedUs : _magOutputUs;
+
+    _accelSched.nextUs = now;
+    _gyroSched.nextUs = now;
+    _tempSched.nextUs = now;
+    _magSched.nextUs = now;
+    _magWaited = false;
 }
 
 void MPU9250::calibrate() {
     uint8_t data[12];
     uint16_t fifo_count;
+    uint8_t if_dis = (_bus == BUS_SPI) ? 0x10 : 0x00; // Keep the I2C slave interface disabled on SPI
+    bool fifo_was_enabled = _fifoEnabled;
     int32_t gyro_bias_sum[3] = {0, 0, 0}, accel_bias_sum[3] = {0, 0, 0};
 
     std::cout << "Starting calibration. Keep the sensor flat and motionless." << std::endl;
@@ -130,8 +333,8 @@ void MPU9250::calibrate() {
     writeByte(_mpu_fd, PWR_MGMT_1, 0x01);   // Set clock source to PLL
     writeByte(_mpu_fd, INT_ENABLE, 0x00);   // Disable all interrupts
     writeByte(_mpu_fd, FIFO_EN, 0x00);      // Disable FIFO
-    writeByte(_mpu_fd, USER_CTRL, 0x00);    // Disable FIFO and I2C master modes
-    writeByte(_mpu_fd, USER_CTRL, 0x04);    // Reset FIFO
+    writeByte(_mpu_fd, USER_CTRL, if_dis);  // Disable FIFO and I2C master modes
+    writeByte(_mpu_fd, USER_CTRL, if_dis | 0x04); // Reset FIFO
     delay(15);
     
     // Configure MPU9250 for bias calculation
@@ -141,7 +344,7 @@ void MPU9250::calibrate() {
     writeByte(_mpu_fd, ACCEL_CONFIG, 0x00); // Set accelerometer full-scale to 2 g
 
     // Configure FIFO to capture accelerometer and gyro data
-    writeByte(_mpu_fd, USER_CTRL, 0x40);   // Enable FIFO
+    writeByte(_mpu_fd, USER_CTRL, if_dis | 0x40); // Enable FIFO
     writeByte(_mpu_fd, FIFO_EN, 0x78);     // Enable accel and gyro FIFO
     delay(80); // Accumulate 80 samples in 80 milliseconds
 
@@ -155,7 +358,7 @@ void MPU9250::calibrate() {
 
     for (int i = 0; i < packet_count; i++) {
         int16_t accel_temp[3], gyro_temp[3];
-        readBytes(_mpu_fd, FIFO_R_W, 12, &data[0]);
+        readFifoBytes(12, &data[0]);
         accel_temp[0] = (int16_t)(((int16_t)data[0] << 8) | data[1]);
         accel_temp[1] = (int16_t)(((int16_t)data[2] << 8) | data[3]);
         accel_temp[2] = (int16_t)(((int16_t)data[4] << 8) | data[5]);
@@ -197,21 +400,136 @@ void MPU9250::calibrate() {
     gyroBias[0] = (float)gyro_bias_sum[0] * _gRes;
     gyroBias[1] = (float)gyro_bias_sum[1] * _gRes;
     gyroBias[2] = (float)gyro_bias_sum[2] * _gRes;
+    _calibrated = true;
+    if (_tempComp) {
+        _tempComp->setReferenceBias(gyroBias);
+    }
+    currentBias(_accelBiasNow, _gyroBiasNow);
     
     std::cout << "Calibration complete." << std::endl;
 
     // Restore original configuration
+    if (_bus == BUS_SPI) {
+        enableAuxMaster();
+    }
     initMPU9250();
+    initAK8963(); // reset() powered the magnetometer down
+    if (fifo_was_enabled) {
+        enableFifo();
+    }
 }
 
 void MPU9250::selfTest() {
     std::cout << "Self-test function not yet fully implemented." << std::endl;
 }
 
+void MPU9250::setTransport(BusTransport* transport) {
+    _transport = transport;
+}
+
+void MPU9250::setTempCompensation(TempCompensation* comp) {
+    _tempComp = comp;
+    if (_tempComp && _calibrated) {
+        _tempComp->setReferenceBias(gyroBias);
+    }
+    currentBias(_accelBiasNow, _gyroBiasNow);
+}
+
 float MPU9250::getAccelRes() { return _aRes; }
 float MPU9250::getGyroRes() { return _gRes; }
 float MPU9250::getMagRes() { return _mRes; }
 
+void MPU9250::enableFifo() {
+    writeByte(_mpu_fd, FIFO_EN, 0x00);
+    writeByte(_mpu_fd, USER_CTRL, userCtrlBase() | 0x04); // Reset FIFO
+    delay(1);
+    writeByte(_mpu_fd, USER_CTRL, userCtrlBase() | 0x40); // Enable FIFO
+    writeByte(_mpu_fd, FIFO_EN, 0x78);                    // Accel and gyro XYZ, 12 bytes per sample
+    _fifoEnabled = true;
+}
+
+void MPU9250::disableFifo() {
+    writeByte(_mpu_fd, FIFO_EN, 0x00);
+    writeByte(_mpu_fd, USER_CTRL, userCtrlBase());
+    _fifoEnabled = false;
+}
+
+int MPU9250::readFifo(ImuSample* dest, int maxSamples) {
+    RawSample raw[FIFO_MAX_SAMPLES];
+    int count = readFifoRaw(raw, (maxSamples < FIFO_MAX_SAMPLES) ? maxSamples : FIFO_MAX_SAMPLES);
+    convertSamples(raw, count, dest);
+
+    // Let the temperature model learn from the uncompensated samples
+    for (int i = 0; _tempComp && i < count; i++) {
+        float accel[3] = {(float)raw[i].accel[0] * _aRes, (float)raw[i].accel[1] * _aRes, (float)raw[i].accel[2] * _aRes};
+        float gyro[3] = {(float)raw[i].gyro[0] * _gRes, (float)raw[i].gyro[1] * _gRes, (float)raw[i].gyro[2] * _gRes};
+        _tempComp->learn(accel, gyro, temperature);
+    }
+    return count;
+}
+
+int MPU9250::readFifoRaw(RawSample* dest, int maxSamples) {
+    uint8_t data[21 * 12]; // Largest whole number of samples a single burst can carry
+
+    readBytes(_mpu_fd, FIFO_COUNTH, 2, &data[0]);
+    uint16_t fifo_count = ((uint16_t)(data[0] & 0x1F) << 8) | data[1];
+
+    // 512 is not a multiple of 12, so once full the packets are misaligned: start over
+    if (fifo_count >= 512) {
+        fifoOverflowCount++;
+        enableFifo();
+        return 0;
+    }
+
+    int packet_count = fifo_count / 12;
+    if (packet_count > maxSamples) {
+        packet_count = maxSamples;
+    }
+
+    // The FIFO carries no temperature: read it once per batch for the compensation
+    int16_t temp = 0;
+    if (packet_count > 0) {
+        temp = readTempData();
+        temperature = ((float)temp) / 333.87f + 21.0f;
+    }
+
+    int done = 0;
+    while (done < packet_count) {
+        int chunk = packet_count - done;
+        if (chunk > 21) chunk = 21;
+        readFifoBytes(chunk * 12, &data[0]);
+        for (int i = 0; i < chunk; i++) {
+            const uint8_t* p = &data[i * 12];
+            RawSample& sample = dest[done + i];
+            sample.accel[0] = (int16_t)(((int16_t)p[0] << 8) | p[1]);
+            sample.accel[1] = (int16_t)(((int16_t)p[2] << 8) | p[3]);
+            sample.accel[2] = (int16_t)(((int16_t)p[4] << 8) | p[5]);
+            sample.temp     = temp;
+            sample.gyro[0]  = (int16_t)(((int16_t)p[6] << 8) | p[7]);
+            sample.gyro[1]  = (int16_t)(((int16_t)p[8] << 8) | p[9]);
+            sample.gyro[2]  = (int16_t)(((int16_t)p[10] << 8) | p[11]);
+            sample.mag[0] = sample.mag[1] = sample.mag[2] = 0;
+        }
+        done += chunk;
+    }
+    return packet_count;
+}
+
+void MPU9250::convertSamples(const RawSample* raw, int count, ImuSample* dest) {
+    // Compensate at the last temperature read
+    float aBias[3], gBias[3];
+    currentBias(aBias, gBias);
+
+    for (int i = 0; i < count; i++) {
+        dest[i].ax = (float)raw[i].accel[0] * _aRes - aBias[0];
+        dest[i].ay = (float)raw[i].accel[1] * _aRes - aBias[1];
+        dest[i].az = (float)raw[i].accel[2] * _aRes - aBias[2];
+        dest[i].gx = (float)raw[i].gyro[0] * _gRes - gBias[0];
+        dest[i].gy = (float)raw[i].gyro[1] * _gRes - gBias[1];
+        dest[i].gz = (float)raw[i].gyro[2] * _gRes - gBias[2];
+    }
+}
+
 void MPU9250::enableWakeOnMotion(float threshold_mg) {
     writeByte(_mpu_fd, PWR_MGMT_1, 0x01);
     writeByte(_mpu_fd, PWR_MGMT_2, 0x00);
@@ -237,19 +555,165 @@ uint8_t MPU9250::getInterruptStatus() {
 // ---- Private Methods ----
 
 void MPU9250::writeByte(int fd, uint8_t reg, uint8_t data) {
+    if (_bus == BUS_SPI) {
+        uint8_t buf[2] = {(uint8_t)(reg & 0x7F), data};
+        spiTransfer(buf, 2, SPI_CONFIG_SPEED_HZ);
+        return;
+    }
+    if (_transport) {
+        _transport->i2cWrite((uint8_t)fd, reg, data);
+        return;
+    }
     wiringPiI2CWriteReg8(fd, reg, data);
 }
 
 uint8_t MPU9250::readByte(int fd, uint8_t reg) {
+    uint8_t data;
+    if (_bus == BUS_SPI) {
+        readBytes(fd, reg, 1, &data);
+        return data;
+    }
+    if (_transport) {
+        return _transport->i2cRead((uint8_t)fd, reg);
+    }
     return wiringPiI2CReadReg8(fd, reg);
 }
 
 void MPU9250::readBytes(int fd, uint8_t reg, uint8_t count, uint8_t* dest) {
+    if (_bus == BUS_SPI) {
+        // Burst read: the first byte carries the register address with the read bit set
+        uint8_t buf[256];
+        buf[0] = reg | 0x80;
+        memset(&buf[1], 0, count);
+        bool fast = (reg >= INT_STATUS && (reg + count - 1) <= EXT_SENS_DATA_23) ||
+                    reg == FIFO_COUNTH || reg == FIFO_R_W;
+        spiTransfer(buf, count + 1, fast ? SPI_DATA_SPEED_HZ : SPI_CONFIG_SPEED_HZ);
+        memcpy(dest, &buf[1], count);
+        return;
+    }
     for (int i = 0; i < count; i++) {
         dest[i] = readByte(fd, reg + i);
     }
 }
 
+void MPU9250::readFifoBytes(uint8_t count, uint8_t* dest) {
+    if (_bus == BUS_SPI) {
+        // Burst reads don't auto-increment past FIFO_R_W: the whole burst drains the FIFO
+        readBytes(_mpu_fd, FIFO_R_W, count, dest);
+        return;
+    }
+    // readBytes() on I2C reads consecutive registers one at a time, so repeat FIFO_R_W instead
+    for (int i = 0; i < count; i++) {
+        dest[i] = readByte(_mpu_fd, FIFO_R_W);
+    }
+}
+
+bool MPU9250::openSPI(int channel) {
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/spidev0.%d", channel);
+    _mpu_fd = open(path, O_RDWR);
+    if (_mpu_fd < 0) {
+        return false;
+    }
+
+    uint8_t mode = SPI_MODE_3;
+    uint8_t bits = 8;
+    uint32_t speed = SPI_DATA_SPEED_HZ;
+    if (ioctl(_mpu_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+        ioctl(_mpu_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+        ioctl(_mpu_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+        close(_mpu_fd);
+        _mpu_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void MPU9250::spiTransfer(uint8_t* buf, uint8_t len, uint32_t speedHz) {
+    // Full duplex in place: buf is sent and overwritten with the received bytes
+    if (_transport) {
+        _transport->spiTransfer(buf, len, speedHz);
+        return;
+    }
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)buf;
+    xfer.rx_buf = (unsigned long)buf;
+    xfer.len = len;
+    xfer.speed_hz = speedHz;
+    xfer.bits_per_word = 8;
+    if (ioctl(_mpu_fd, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+        std::cerr << "ERROR: SPI transfer failed." << std::endl;
+    }
+}
+
+void MPU9250::writeMagByte(uint8_t reg, uint8_t data) {
+    if (_bus == BUS_I2C) {
+        writeByte(_mag_fd, reg, data);
+        return;
+    }
+    writeByte(_mpu_fd, I2C_SLV4_ADDR, AK8963_ADDRESS);
+    writeByte(_mpu_fd, I2C_SLV4_REG, reg);
+    writeByte(_mpu_fd, I2C_SLV4_DO, data);
+    writeByte(_mpu_fd, I2C_SLV4_CTRL, 0x80 | _auxDelay); // Start a single-byte transfer
+    if (!waitAuxTransfer()) {
+        std::cerr << "ERROR: AK8963 write through auxiliary I2C timed out." << std::endl;
+    }
+}
+
+uint8_t MPU9250::readMagByte(uint8_t reg) {
+    if (_bus == BUS_I2C) {
+        return readByte(_mag_fd, reg);
+    }
+    writeByte(_mpu_fd, I2C_SLV4_ADDR, AK8963_ADDRESS | 0x80);
+    writeByte(_mpu_fd, I2C_SLV4_REG, reg);
+    writeByte(_mpu_fd, I2C_SLV4_CTRL, 0x80 | _auxDelay);
+    if (!waitAuxTransfer()) {
+        std::cerr << "ERROR: AK8963 read through auxiliary I2C timed out." << std::endl;
+        return 0;
+    }
+    return readByte(_mpu_fd, I2C_SLV4_DI);
+}
+
+void MPU9250::readMagBytes(uint8_t reg, uint8_t count, uint8_t* dest) {
+    if (_bus == BUS_I2C) {
+        readBytes(_mag_fd, reg, count, dest);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        dest[i] = readMagByte(reg + i);
+    }
+}
+
+bool MPU9250::waitAuxTransfer() {
+    // SLV4 transfers run once per sample period, so allow a few periods at the slowest rate
+    for (int i = 0; i < 50; i++) {
+        if (readByte(_mpu_fd, I2C_MST_STATUS) & 0x40) { // I2C_SLV4_DONE
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+uint8_t MPU9250::userCtrlBase() {
+    // On SPI the I2C slave interface stays disabled and the auxiliary master enabled
+    return (_bus == BUS_SPI) ? 0x30 : 0x00;
+}
+
+void MPU9250::enableAuxMaster() {
+    // Disable the I2C slave interface and enable the I2C master, clocked at 400 kHz
+    writeByte(_mpu_fd, USER_CTRL, 0x30);
+    writeByte(_mpu_fd, I2C_MST_CTRL, 0x0D);
+    delay(10);
+
+    // SLV0 continuously mirrors ST1..ST2 into EXT_SENS_DATA_00..07, so a
+    // magnetometer fetch becomes a single 20 MHz SPI burst.
+    writeByte(_mpu_fd, I2C_SLV0_ADDR, AK8963_ADDRESS | 0x80);
+    writeByte(_mpu_fd, I2C_SLV0_REG, AK8963_ST1);
+    writeByte(_mpu_fd, I2C_SLV0_CTRL, 0x80 | 8);
+}
+
 void MPU9250::readAccelData(int16_t* destination) {
     uint8_t rawData[6];
     readBytes(_mpu_fd, ACCEL_XOUT_H, 6, &rawData[0]);
@@ -266,16 +730,75 @@ void MPU9250::readGyroData(int16_t* destination) {
     destination[2] = (int16_t)(((int16_t)rawData[4] << 8) | rawData[5]);
 }
 
-void MPU9250::readMagData(int16_t* destination) {
+bool MPU9250::readMagData(int16_t* destination) {
     uint8_t rawData[7];
-    if (readByte(_mag_fd, AK8963_ST1) & 0x01) {
-        readBytes(_mag_fd, AK8963_XOUT_L, 7, &rawData[0]);
-        if (!(rawData[6] & 0x08)) {
-            destination[0] = (int16_t)(((int16_t)rawData[1] << 8) | rawData[0]);
-            destination[1] = (int16_t)(((int16_t)rawData[3] << 8) | rawData[2]);
-            destination[2] = (int16_t)(((int16_t)rawData[5] << 8) | rawData[4]);
+    uint8_t st1;
+    if (_bus == BUS_SPI) {
+        // ST1, data and ST2 as last mirrored by the auxiliary I2C master. SLV0 reads
+        // ST2 on every cycle, which clears DRDY, so only the first mirror of a sample
+        // shows it: a sample is also new when its data differs from the last one taken.
+        // An unchanged block with DRDY clear is at worst a repeat of the same values.
+        uint8_t extData[8];
+        readBytes(_mpu_fd, EXT_SENS_DATA_00, 8, &extData[0]);
+        st1 = extData[0];
+        memcpy(rawData, &extData[1], 7);
+        if (memcmp(rawData, _magShadow, 7) != 0) {
+            st1 |= 0x01;
         }
+        if (st1 & 0x01) {
+            memcpy(_magShadow, rawData, 7);
+        }
+    } else {
+        st1 = readByte(_mag_fd, AK8963_ST1);
+    }
+    if (!(st1 & 0x01)) {
+        return false; // No new sample yet, try again on the next update
     }
+    if ((st1 & 0x02) && _bus == BUS_I2C && _magSched.periodUs == _magOutputUs) {
+        magMissedCount++; // Data overrun: at least one sample was skipped unintentionally
+    }
+
+    // Reading through ST2 releases the data registers for the next measurement
+    if (_bus == BUS_I2C) {
+        readBytes(_mag_fd, AK8963_XOUT_L, 7, &rawData[0]);
+    }
+    if (rawData[6] & 0x08) {
+        magOverflowCount++;
+        return false;
+    }
+
+    destination[0] = (int16_t)(((int16_t)rawData[1] << 8) | rawData[0]);
+    destination[1] = (int16_t)(((int16_t)rawData[3] << 8) | rawData[2]);
+    destination[2] = (int16_t)(((int16_t)rawData[5] << 8) | rawData[4]);
+    return true;
+}
+
+void MPU9250::readAccelTempGyroData(int16_t* destination) {
+    uint8_t rawData[14];
+    readBytes(_mpu_fd, ACCEL_XOUT_H, 14, &rawData[0]);
+    for (int i = 0; i < 7; i++) {
+        destination[i] = (int16_t)(((int16_t)rawData[2 * i] << 8) | rawData[2 * i + 1]);
+    }
+}
+
+void MPU9250::currentBias(float aBias[3], float gBias[3]) {
+    // The temperature model once it has learned something, the calibration otherwise
+    if (_tempComp && _tempComp->getBias(temperature, aBias, gBias)) {
+        return;
+    }
+    memcpy(aBias, accelBias, sizeof(accelBias));
+    memcpy(gBias, gyroBias, sizeof(gyroBias));
+}
+
+bool MPU9250::isDue(ChannelSchedule& sched, uint32_t now) {
+    if (sched.periodUs == CHANNEL_OFF || (int32_t)(now - sched.nextUs) < 0) {
+        return false;
+    }
+    sched.nextUs += sched.periodUs;
+    if ((int32_t)(now - sched.nextUs) >= 0) {
+        sched.nextUs = now + sched.periodUs; // Fell behind: skip rather than read in a burst
+    }
+    return true;
 }
 
 int16_t MPU9250::readTempData() {
@@ -287,57 +810,113 @@ int16_t MPU9250::readTempData() {
 void MPU9250::initMPU9250() {
     writeByte(_mpu_fd, PWR_MGMT_1, 0x01); // Set clock source to auto select
 
-    writeByte(_mpu_fd, CONFIG, GYRO_DLPF_41HZ); 
-    writeByte(_mpu_fd, SMPLRT_DIV, 0x04); // Set sample rate to 200Hz (1kHz / (1+4))
-    
     uint8_t c = readByte(_mpu_fd, GYRO_CONFIG);
     writeByte(_mpu_fd, GYRO_CONFIG, (c & ~0x18) | (_gscale << 3));
     
     c = readByte(_mpu_fd, ACCEL_CONFIG);
     writeByte(_mpu_fd, ACCEL_CONFIG, (c & ~0x18) | (_ascale << 3));
 
-    c = readByte(_mpu_fd, ACCEL_CONFIG2);
-    writeByte(_mpu_fd, ACCEL_CONFIG2, (c & ~0x0F) | ACCEL_DLPF_41HZ);
+    applyOutputDataRate();
 
-    writeByte(_mpu_fd, INT_PIN_CFG, 0x22);    
+    // Latch INT until read; bypass must stay off on SPI where the auxiliary master owns the bus
+    writeByte(_mpu_fd, INT_PIN_CFG, (_bus == BUS_SPI) ? 0x20 : 0x22);
     writeByte(_mpu_fd, INT_ENABLE, 0x01);
     delay(100);
 }
 
 void MPU9250::initAK8963() {
     uint8_t rawData[3];
-    writeByte(_mag_fd, AK8963_CNTL, M_POWER_DOWN);
+    writeMagByte(AK8963_CNTL, M_POWER_DOWN);
     delay(10);
-    writeByte(_mag_fd, AK8963_CNTL, M_FUSE_ROM_ACCESS);
+    writeMagByte(AK8963_CNTL, M_FUSE_ROM_ACCESS);
     delay(10);
     
-    readBytes(_mag_fd, AK8963_ASAX, 3, &rawData[0]);
+    readMagBytes(AK8963_ASAX, 3, &rawData[0]);
     magCalibration[0] = (float)(rawData[0] - 128) / 256.0f + 1.0f;
     magCalibration[1] = (float)(rawData[1] - 128) / 256.0f + 1.0f;
     magCalibration[2] = (float)(rawData[2] - 128) / 256.0f + 1.0f;
     
-    writeByte(_mag_fd, AK8963_CNTL, M_POWER_DOWN);
+    writeMagByte(AK8963_CNTL, M_POWER_DOWN);
     delay(10);
     
-    writeByte(_mag_fd, AK8963_CNTL, (_mscale << 4) | _mmode);
+    writeMagByte(AK8963_CNTL, (_mscale << 4) | _mmode);
     delay(10);
+
+    // Only the continuous modes have a fixed output rate to schedule against
+    switch (_mmode) {
+        case M_8Hz_CONTINUOUS:   _magOutputUs = 125000; break;
+        case M_100Hz_CONTINUOUS: _magOutputUs = 10000;  break;
+        default:                 _magOutputUs = 0;      break;
+    }
+    _magSched.periodUs = (_magRequestedUs > _magOutputUs) ? _magRequestedUs : _magOutputUs;
+    _magSched.nextUs = micros();
+    _magWaited = false;
+    _magTaken = false;
+    memset(_magShadow, 0, sizeof(_magShadow));
+    magFresh = false;
+    magMissedCount = 0;
+    magOverflowCount = 0;
 }
 
-void MPU9250::updateResolutions() {
-    switch (_ascale) {
-        case AFS_2G:  _aRes = 2.0f / 32768.0f; break;
-        case AFS_4G:  _aRes = 4.0f / 32768.0f; break;
-        case AFS_8G:  _aRes = 8.0f / 32768.0f; break;
-        case AFS_16G: _aRes = 16.0f / 32768.0f; break;
-    }
-    switch (_gscale) {
-        case GFS_250DPS:  _gRes = 250.0f / 32768.0f; break;
-        case GFS_500DPS:  _gRes = 500.0f / 32768.0f; break;
-        case GFS_1000DPS: _gRes = 1000.0f / 32768.0f; break;
-        case GFS_2000DPS: _gRes = 2000.0f / 32768.0f; break;
-    }
-    switch (_mscale) {
-        case MFS_14BITS: _mRes = 10.0f * 4912.0f / 8190.0f; break;
-        case MFS_16BITS: _mRes = 10.0f * 4912.0f / 32760.0f; break;
+void MPU9250::applyOutputDataRate() {
+    writeByte(_mpu_fd, CONFIG, _gyroDlpf & 0x07);
+    writeByte(_mpu_fd, SMPLRT_DIV, _sampleRateDiv);
+
+    uint8_t c = readByte(_mpu_fd, GYRO_CONFIG);
+    writeByte(_mpu_fd, GYRO_CONFIG, (c & ~0x03) | ((_gyroDlpf >> 3) & 0x03));
+
+    c = readByte(_mpu_fd, ACCEL_CONFIG2);
+    writeByte(_mpu_fd, ACCEL_CONFIG2, (c & ~0x0F) | _accelDlpf);
+
+    if (_bus == BUS_SPI) {
+        // The auxiliary master runs once per sample; at kHz rates, slow SLV0 down
+        // to roughly 200 Hz so the AK8963 transfers fit and still outpace its 100 Hz output.
+        int dly = (int)(getGyroSampleRate() / 200.0f + 0.5f) - 1;
+        if (dly < 0) dly = 0;
+        if (dly > 31) dly = 31;
+        _auxDelay = (uint8_t)dly;
+        writeByte(_mpu_fd, I2C_SLV4_CTRL, _auxDelay);
+        writeByte(_mpu_fd, I2C_MST_DELAY_CTRL, 0x81); // Shadow external data, delay SLV0
     }
 }
+
+void MPU9250::configureScales(Ascale ascale, Gscale gscale, Mscale mscale) {
+    _ascale = ascale;
+    _gscale = gscale;
+    _mscale = mscale;
+    updateResolutions();
+}
+
+float MPU9250::accelResolution(Ascale ascale) {
+    switch (ascale) {
+        case AFS_2G:  return 2.0f / 32768.0f;
+        case AFS_4G:  return 4.0f / 32768.0f;
+        case AFS_8G:  return 8.0f / 32768.0f;
+        case AFS_16G: return 16.0f / 32768.0f;
+    }
+    return 0.0f;
+}
+
+float MPU9250::gyroResolution(Gscale gscale) {
+    switch (gscale) {
+        case GFS_250DPS:  return 250.0f / 32768.0f;
+        case GFS_500DPS:  return 500.0f / 32768.0f;
+        case GFS_1000DPS: return 1000.0f / 32768.0f;
+        case GFS_2000DPS: return 2000.0f / 32768.0f;
+    }
+    return 0.0f;
+}
+
+float MPU9250::magResolution(Mscale mscale) {
+    switch (mscale) {
+        case MFS_14BITS: return 10.0f * 4912.0f / 8190.0f;
+        case MFS_16BITS: return 10.0f * 4912.0f / 32760.0f;
+    }
+    return 0.0f;
+}
+
+void MPU9250::updateResolutions() {
+    _aRes = accelResolution(_ascale);
+    _gRes = gyroResolution(_gscale);
+    _mRes = magResolution(_mscale);
+}
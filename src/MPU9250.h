@@ -39,16 +39,19 @@ enum Mmode {
     M_FUSE_ROM_ACCESS = 0x0F
 };
 
-// Gyroscope Digital Low-Pass Filter (Register 26: CONFIG)
+// Gyroscope Digital Low-Pass Filter (Register 26: CONFIG, Register 27: GYRO_CONFIG FCHOICE_B)
+// Bits [2:0] are DLPF_CFG, bits [4:3] are FCHOICE_B for the bypass modes.
 enum GyroDLPF {
-    GYRO_DLPF_250HZ = 0,
-    GYRO_DLPF_184HZ,
+    GYRO_DLPF_250HZ = 0,        // 8 kHz
+    GYRO_DLPF_184HZ,            // 1 kHz / (1 + SMPLRT_DIV)
     GYRO_DLPF_92HZ,
     GYRO_DLPF_41HZ,
     GYRO_DLPF_20HZ,
     GYRO_DLPF_10HZ,
     GYRO_DLPF_5HZ,
-    GYRO_DLPF_3600HZ
+    GYRO_DLPF_3600HZ,           // 8 kHz
+    GYRO_DLPF_BYPASS_8800HZ = 0x08, // 32 kHz, FCHOICE_B = 01
+    GYRO_DLPF_BYPASS_3600HZ = 0x10  // 32 kHz, FCHOICE_B = 10
 };
 
 // Accelerometer Digital Low-Pass Filter (Register 29: ACCEL_CONFIG 2)
@@ -60,7 +63,14 @@ enum AccelDLPF {
     ACCEL_DLPF_20HZ,
     ACCEL_DLPF_10HZ,
     ACCEL_DLPF_5HZ,
-    ACCEL_DLPF_460HZ_2 // Same as 0
+    ACCEL_DLPF_460HZ_2, // Same as 0
+    ACCEL_DLPF_BYPASS_1130HZ = 0x08 // 4 kHz, ACCEL_FCHOICE_B = 1
+};
+
+// Host Bus Interface
+enum Bus {
+    BUS_I2C = 0, // wiringPi I2C, AK8963 reached through bypass mode
+    BUS_SPI      // spidev, AK8963 reached through the MPU9250 auxiliary I2C master
 };
 
 // Clock Source (Register 107: PWR_MGMT_1)
@@ -69,31 +79,105 @@ enum ClockSource {
     CLK_AUTO_SELECT,
     CLK_STOP_CLOCK = 7
 };
+class TempCompensation;
+class BusTransport;
+
+// One sample in the sensor's native format: register counts as read from the device
+struct RawSample {
+    int16_t accel[3];
+    int16_t temp;
+    int16_t gyro[3];
+    int16_t mag[3]; // Before the fuse ROM sensitivity adjustment
+};
+
+// One accelerometer + gyroscope sample read from the FIFO, in g's and dps
+struct ImuSample {
+    float ax, ay, az;
+    float gx, gy, gz;
+};
 
 
 class MPU9250 {
 public:
     // ---- Public Variables ----
     float ax, ay, az, gx, gy, gz, mx, my, mz; // Variables to store sensor data in real-world units (g's, dps, mG)
-    float temperature; // Temperature in degrees Celsius
+    float temperature = 21.0f; // Temperature in degrees Celsius (21 C reads as TEMP_OUT = 0)
 
     float gyroBias[3] = {0, 0, 0};
     float accelBias[3] = {0, 0, 0};
     float magBias[3] = {0, 0, 0};
     float magCalibration[3] = {0, 0, 0};
 
+    // Magnetometer sample status
+    bool magFresh = false;         // true if mx/my/mz were refreshed by the last update(), false if held
+    uint32_t magMissedCount = 0;   // Times at least one sample was overwritten before being read: ST1 DOR on
+                                   // I2C, a gap of more than an output period since the last sample on SPI
+    uint32_t magOverflowCount = 0; // Samples discarded due to magnetic sensor overflow (ST2 HOFL)
+
+    // Per-channel freshness of the last update()
+    bool accelFresh = false;
+    bool gyroFresh = false;
+    bool tempFresh = false;
+
+    uint32_t fifoOverflowCount = 0; // Times the FIFO filled up and was reset, losing samples
+
+    RawSample raw = {}; // Register counts of the last read of each channel; held like the floats
 
     // ---- Public Methods ----
     MPU9250(); 
 
-    bool init(Ascale ascale = AFS_2G, Gscale gscale = GFS_250DPS, Mscale mscale = MFS_16BITS, Mmode mmode = M_100Hz_CONTINUOUS);
+    bool init(Ascale ascale = AFS_2G, Gscale gscale = GFS_250DPS, Mscale mscale = MFS_16BITS, Mmode mmode = M_100Hz_CONTINUOUS,
+              Bus bus = BUS_I2C, int spiChannel = 0);
     bool whoAmI();
     void reset();
-    void update(); // Reads all sensors and updates public variables
+    void update(); // Reads the sensors that are due and updates public variables
+    void updateRaw(); // Like update(), but only refreshes raw, temperature and the fresh flags: no float conversion
+
+    // On-demand conversion of the counts in raw, with the biases the last
+    // updateRaw() looked up at its temperature, as update() uses
+    float accelG(int axis);
+    float gyroDps(int axis);
+    float magMg(int axis);
+    float temperatureC();
+
+    // A threshold converted once to counts (bias included), to compare against raw
+    // in the loop instead of converting every sample. Recompute after calibrate(),
+    // a scale change, or as the temperature model's bias drifts.
+    int16_t accelThresholdRaw(int axis, float g);
+    int16_t gyroThresholdRaw(int axis, float dps);
+
+    // Output data rate: DLPF bandwidths (including the FCHOICE bypass modes) and
+    // the sample rate divider. Applied immediately if the device is initialized.
+    void setOutputDataRate(GyroDLPF gyroDlpf, AccelDLPF accelDlpf, uint8_t sampleRateDiv);
+    float getGyroSampleRate();  // Hz
+    float getAccelSampleRate(); // Hz
+
+    // How often update() reads each channel, in Hz. 0 reads on every update(),
+    // a negative rate never reads the channel.
+    // The magnetometer is never read faster than its own output rate.
+    void setChannelRates(float accelHz, float gyroHz, float magHz, float tempHz);
+
+    // Routes all register access through a transport instead of wiringPi/spidev,
+    // e.g. to a SimulatedMPU9250. Call before init(), which then skips wiringPiSetup();
+    // nullptr restores the hardware.
+    void setTransport(BusTransport* transport);
 
     void calibrate(); // Performs accelerometer and gyroscope calibration
     void selfTest(); // Performs a factory self-test
 
+    // Temperature compensation: when set, update() and readFifo() take biases from the
+    // model instead of accelBias/gyroBias once it has learned, and feed it uncompensated
+    // samples to learn from. The calibration's gyro bias seeds the model's reference.
+    // Pass nullptr to detach.
+    void setTempCompensation(TempCompensation* comp);
+
+    // FIFO streaming: accel + gyro samples are queued at the sample rate and drained in batches
+    static const int FIFO_MAX_SAMPLES = 512 / 12;
+    void enableFifo();
+    void disableFifo();
+    int readFifo(ImuSample* dest, int maxSamples); // Returns the number of samples written to dest
+    int readFifoRaw(RawSample* dest, int maxSamples); // Same, as counts: temp is the batch's, mag is 0
+
     // Interrupt Methods
     void enableWakeOnMotion(float threshold_mg);
     uint8_t getInterruptStatus();
@@ -103,10 +187,24 @@ public:
     float getGyroRes();
     float getMagRes();
 
+    // Resolution of each full-scale setting, per LSB
+    static float accelResolution(Ascale ascale); // g
+    static float gyroResolution(Gscale gscale);  // dps
+    static float magResolution(Mscale mscale);   // mG
+
+    // Sets the scales used for conversion without touching the device, for
+    // processing recorded or simulated data. init() applies them to the device.
+    void configureScales(Ascale ascale, Gscale gscale, Mscale mscale);
+
+    // Converts raw accel + gyro counts with the current resolutions and biases,
+    // exactly as readFifo() does
+    void convertSamples(const RawSample* raw, int count, ImuSample* dest);
+
 private:
     // ---- Private Member Variables ----
-    int _mpu_fd = -1;
-    int _mag_fd = -1;
+    int _mpu_fd = -1; // I2C or spidev file descriptor, depending on _bus
+    int _mag_fd = -1; // Only used on BUS_I2C
+    Bus _bus = BUS_I2C;
     
     Ascale _ascale;
     Gscale _gscale;
@@ -114,22 +212,65 @@ private:
     Mmode  _mmode;
 
     float _aRes, _gRes, _mRes; // Sensor resolutions
+
+    GyroDLPF  _gyroDlpf = GYRO_DLPF_41HZ;
+    AccelDLPF _accelDlpf = ACCEL_DLPF_41HZ;
+    uint8_t   _sampleRateDiv = 4; // 200 Hz
+    uint8_t   _auxDelay = 0;      // Auxiliary I2C master accesses every (1 + _auxDelay) samples
+    bool      _fifoEnabled = false;
+    TempCompensation* _tempComp = nullptr;
+    BusTransport* _transport = nullptr;
+    bool _calibrated = false;
+    float _accelBiasNow[3] = {0, 0, 0}; // currentBias() as of the last updateRaw()
+    float _gyroBiasNow[3] = {0, 0, 0};
+
+    // Read scheduling for one channel of update()
+    struct ChannelSchedule {
+        uint32_t periodUs = 0; // 0 = read on every update, CHANNEL_OFF = never
+        uint32_t nextUs = 0;   // micros() timestamp at which the next read is due
+    };
+    static const uint32_t CHANNEL_OFF = 0xFFFFFFFF;
+    ChannelSchedule _accelSched, _gyroSched, _tempSched;
+    ChannelSchedule _magSched;
+    uint32_t _magRequestedUs = 0; // Period asked for by setChannelRates()
+    uint32_t _magOutputUs = 0;    // Period of the AK8963 continuous mode (0 = not continuous)
+    bool _magWaited = false;      // The current sample was not ready when first polled
+    bool _magTaken = false;       // _magTakenUs holds when the last sample was read (SPI miss count)
+    uint32_t _magTakenUs = 0;
+    uint8_t _magShadow[7] = {};   // Data and ST2 of the last sample taken from the SPI mirror
     
     // ---- Low-level Private Methods ----
     void writeByte(int fd, uint8_t reg, uint8_t data);
     uint8_t readByte(int fd, uint8_t reg);
     void readBytes(int fd, uint8_t reg, uint8_t count, uint8_t* dest);
+    void readFifoBytes(uint8_t count, uint8_t* dest); // Drains count bytes from FIFO_R_W
+
+    // SPI transport
+    bool openSPI(int channel);
+    void spiTransfer(uint8_t* buf, uint8_t len, uint32_t speedHz);
+
+    // Magnetometer register access, routed through the auxiliary I2C master on BUS_SPI
+    void writeMagByte(uint8_t reg, uint8_t data);
+    uint8_t readMagByte(uint8_t reg);
+    void readMagBytes(uint8_t reg, uint8_t count, uint8_t* dest);
+    bool waitAuxTransfer();
+    uint8_t userCtrlBase();
+    void enableAuxMaster();
 
     // Raw data reading methods
     void readAccelData(int16_t* destination);
     void readGyroData(int16_t* destination);
-    void readMagData(int16_t* destination);
+    bool readMagData(int16_t* destination);
     int16_t readTempData();
+    void readAccelTempGyroData(int16_t* destination);
+    bool isDue(ChannelSchedule& sched, uint32_t now);
+    void currentBias(float aBias[3], float gBias[3]); // Temperature model or calibration
 
     // Internal initialization methods
     void initMPU9250();
     void initAK8963();
     void updateResolutions();
+    void applyOutputDataRate();
 };
 
 #endif // MPU9250_H
@@ -0,0 +1,188 @@
+#include "MotionSimulator.h"
+#include <cmath>
+
+MotionSimulator::MotionSimulator(float sampleRateHz, Ascale ascale, Gscale gscale, Mscale mscale, uint32_t seed) {
+    _sampleRateHz = sampleRateHz;
+    _dt = 1.0f / sampleRateHz;
+    _aRes = MPU9250::accelResolution(ascale);
+    _gRes = MPU9250::gyroResolution(gscale);
+    _mRes = MPU9250::magResolution(mscale);
+    _rng = 0x9E3779B97F4A7C15ULL ^ seed;
+    reset();
+}
+
+void MotionSimulator::addStill(float durationS) {
+    const float none[3] = {0, 0, 0};
+    addSegment(SEG_STILL, durationS, none, 0.0f, 0.0f);
+}
+
+void MotionSimulator::addRotation(float durationS, const float axis[3], float rateDps) {
+    addSegment(SEG_ROTATE, durationS, axis, rateDps, 0.0f);
+}
+
+void MotionSimulator::addVibration(float durationS, const float axis[3], float amplitudeG, float frequencyHz) {
+    addSegment(SEG_VIBRATE, durationS, axis, amplitudeG, frequencyHz);
+}
+
+void MotionSimulator::addShock(const float axis[3], float peakG, float durationMs) {
+    addSegment(SEG_SHOCK, durationMs / 1000.0f, axis, peakG, 0.0f);
+}
+
+void MotionSimulator::addMagDisturbance(float durationS, const float offsetMg[3]) {
+    Segment seg = {SEG_MAG, durationS, {offsetMg[0], offsetMg[1], offsetMg[2]}, 0.0f, 0.0f};
+    _segments.push_back(seg);
+}
+
+void MotionSimulator::addSegment(SegmentType type, float durationS, const float axis[3], float magnitude, float frequencyHz) {
+    Segment seg = {type, durationS, {axis[0], axis[1], axis[2]}, magnitude, frequencyHz};
+    float norm = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (norm > 0.0f) {
+        for (int i = 0; i < 3; i++) {
+            seg.axis[i] /= norm;
+        }
+    }
+    _segments.push_back(seg);
+}
+
+void MotionSimulator::reset() {
+    _segment = 0;
+    _segmentT = 0.0f;
+    _t = 0.0f;
+    _q[0] = 1.0f;
+    _q[1] = _q[2] = _q[3] = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        _accelBias[i] = noise.accelBiasInitial * uniform();
+        _gyroBias[i] = noise.gyroBiasInitial * uniform();
+    }
+}
+
+int MotionSimulator::generate(RawSample* dest, int count) {
+    // White noise spread over the Nyquist band of the output rate
+    float accelSigma = noise.accelNoiseDensity * sqrtf(_sampleRateHz / 2.0f);
+    float gyroSigma = noise.gyroNoiseDensity * sqrtf(_sampleRateHz / 2.0f);
+    float accelWalk = noise.accelBiasWalk * sqrtf(_dt);
+    float gyroWalk = noise.gyroBiasWalk * sqrtf(_dt);
+    const float degToRad = (float)M_PI / 180.0f;
+
+    for (int n = 0; n < count; n++) {
+        // Advance through the script
+        while (_segment < _segments.size() && _segmentT >= _segments[_segment].durationS) {
+            _segmentT -= _segments[_segment].durationS;
+            _segment++;
+        }
+        if (_segment >= _segments.size()) {
+            if (!_loop || _segments.empty()) {
+                return n;
+            }
+            _segment = 0;
+        }
+        const Segment& seg = _segments[_segment];
+
+        float omega[3] = {0, 0, 0};    // dps, sensor frame
+        float linear[3] = {0, 0, 0};   // g, sensor frame
+        float magOffset[3] = {0, 0, 0}; // mG, world frame
+        switch (seg.type) {
+            case SEG_STILL:
+                break;
+            case SEG_ROTATE:
+                for (int i = 0; i < 3; i++) omega[i] = seg.axis[i] * seg.magnitude;
+                break;
+            case SEG_VIBRATE: {
+                float a = seg.magnitude * sinf(2.0f * (float)M_PI * seg.frequencyHz * _segmentT);
+                for (int i = 0; i < 3; i++) linear[i] = seg.axis[i] * a;
+                break;
+            }
+            case SEG_SHOCK: {
+                float a = seg.magnitude * sinf((float)M_PI * _segmentT / seg.durationS);
+                for (int i = 0; i < 3; i++) linear[i] = seg.axis[i] * a;
+                break;
+            }
+            case SEG_MAG:
+                for (int i = 0; i < 3; i++) magOffset[i] = seg.axis[i];
+                break;
+        }
+
+        // Integrate the orientation by the body rotation over this sample
+        float rate = sqrtf(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]);
+        if (rate > 0.0f) {
+            float half = 0.5f * rate * degToRad * _dt;
+            float s = sinf(half) / rate;
+            float d[4] = {cosf(half), omega[0] * s, omega[1] * s, omega[2] * s};
+            float q[4] = {
+                _q[0] * d[0] - _q[1] * d[1] - _q[2] * d[2] - _q[3] * d[3],
+                _q[0] * d[1] + _q[1] * d[0] + _q[2] * d[3] - _q[3] * d[2],
+                _q[0] * d[2] - _q[1] * d[3] + _q[2] * d[0] + _q[3] * d[1],
+                _q[0] * d[3] + _q[1] * d[2] - _q[2] * d[1] + _q[3] * d[0]
+            };
+            float norm = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            for (int i = 0; i < 4; i++) _q[i] = q[i] * norm;
+        }
+
+        // World to sensor frame: the transpose of the sensor-to-world rotation
+        float w = _q[0], x = _q[1], y = _q[2], z = _q[3];
+        float r[3][3] = {
+            {1 - 2 * (y * y + z * z), 2 * (x * y - w * z),     2 * (x * z + w * y)},
+            {2 * (x * y + w * z),     1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+            {2 * (x * z - w * y),     2 * (y * z + w * x),     1 - 2 * (x * x + y * y)}
+        };
+        float field[3] = {earthField[0] + magOffset[0], earthField[1] + magOffset[1], earthField[2] + magOffset[2]};
+
+        // Die temperature and bias random walk
+        float temp = noise.tempStartC + noise.tempRateCPerS * _t;
+        float gyroTempBias = noise.gyroBiasPerC * (temp - 25.0f);
+
+        RawSample& out = dest[n];
+        for (int i = 0; i < 3; i++) {
+            _accelBias[i] += accelWalk * gaussian();
+            _gyroBias[i] += gyroWalk * gaussian();
+
+            // A resting accelerometer reads +1g along world up
+            float accel = r[2][i] + linear[i] + _accelBias[i] + accelSigma * gaussian();
+            float gyro = omega[i] + _gyroBias[i] + gyroTempBias + gyroSigma * gaussian();
+            float mag = r[0][i] * field[0] + r[1][i] * field[1] + r[2][i] * field[2] + noise.magNoise * gaussian();
+
+            out.accel[i] = quantize(accel, _aRes);
+            out.gyro[i] = quantize(gyro, _gRes);
+            out.mag[i] = quantize(mag, _mRes);
+        }
+        out.temp = quantize(temp - 21.0f, 1.0f / 333.87f);
+
+        _segmentT += _dt;
+        _t += _dt;
+    }
+    return count;
+}
+
+int16_t MotionSimulator::quantize(float value, float resolution) {
+    float counts = roundf(value / resolution);
+    if (counts > 32767.0f) return 32767;
+    if (counts < -32768.0f) return -32768;
+    return (int16_t)counts;
+}
+
+float MotionSimulator::uniform() {
+    // xorshift64*
+    _rng ^= _rng >> 12;
+    _rng ^= _rng << 25;
+    _rng ^= _rng >> 27;
+    uint64_t bits = _rng * 0x2545F4914F6CDD1DULL;
+    return (float)(bits >> 40) / (float)(1 << 23) - 1.0f;
+}
+
+float MotionSimulator::gaussian() {
+    // Marsaglia polar method, keeping the second value for the next call
+    if (_haveSpare) {
+        _haveSpare = false;
+        return _spare;
+    }
+    float u, v, s;
+    do {
+        u = uniform();
+        v = uniform();
+        s = u * u + v * v;
+    } while (s >= 1.0f || s == 0.0f);
+    float m = sqrtf(-2.0f * logf(s) / s);
+    _spare = v * m;
+    _haveSpare = true;
+    return u * m;
+}
@@ -0,0 +1,94 @@
+#ifndef MOTION_SIMULATOR_H
+#define MOTION_SIMULATOR_H
+
+#include "MPU9250.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Sensor error model. Defaults follow the MPU9250 / AK8963 datasheets.
+struct SensorNoise {
+    float accelNoiseDensity = 300e-6f; // g/sqrt(Hz)
+    float gyroNoiseDensity = 0.01f;    // dps/sqrt(Hz)
+    float magNoise = 4.0f;             // mG rms per sample
+    float accelBiasWalk = 20e-6f;      // g/sqrt(s)
+    float gyroBiasWalk = 0.002f;       // dps/sqrt(s)
+    float accelBiasInitial = 0.02f;    // Initial bias drawn uniformly within +/- this, g
+    float gyroBiasInitial = 1.0f;      // dps
+    float tempStartC = 25.0f;
+    float tempRateCPerS = 0.0f;        // Die temperature ramp
+    float gyroBiasPerC = 0.02f;        // Gyro bias temperature coefficient, dps/C
+};
+
+// Generates 9-axis samples from a scripted trajectory, in the driver's raw count
+// format, so the processing pipeline can be load-tested without hardware and far
+// faster than real time.
+//
+// The script is a sequence of segments. Rotations are integrated into an
+// orientation that turns gravity and the earth's field into the sensor frame;
+// vibration, shocks and magnetic disturbances are added on top. Noise, bias
+// random walk, temperature drift, quantization and clipping are then applied with
+// the same resolutions MPU9250 uses for conversion. SimulatedMPU9250 serves the
+// samples through a register map, to exercise the driver's bus and decode code.
+class MotionSimulator {
+public:
+    MotionSimulator(float sampleRateHz, Ascale ascale = AFS_2G, Gscale gscale = GFS_250DPS,
+                    Mscale mscale = MFS_16BITS, uint32_t seed = 1);
+
+    // ---- Trajectory script ----
+    void addStill(float durationS);
+    void addRotation(float durationS, const float axis[3], float rateDps);
+    void addVibration(float durationS, const float axis[3], float amplitudeG, float frequencyHz);
+    void addShock(const float axis[3], float peakG, float durationMs); // Half-sine pulse
+    void addMagDisturbance(float durationS, const float offsetMg[3]);
+    void setLoop(bool loop) { _loop = loop; } // Restart the script instead of ending
+
+    SensorNoise noise;
+    float earthField[3] = {200.0f, 0.0f, -400.0f}; // World frame, mG
+
+    /**
+     * @brief Generates the next samples of the script.
+     * @return The number of samples written; fewer than count once a non-looping script ends.
+     */
+    int generate(RawSample* dest, int count);
+
+    void reset(); // Back to the start of the script with a level orientation
+
+    float getTime() const { return _t; }
+    float getSampleRate() const { return _sampleRateHz; }
+
+private:
+    enum SegmentType { SEG_STILL, SEG_ROTATE, SEG_VIBRATE, SEG_SHOCK, SEG_MAG };
+    struct Segment {
+        SegmentType type;
+        float durationS;
+        float axis[3];    // Unit axis, or mG offset for SEG_MAG
+        float magnitude;  // dps, g or unused
+        float frequencyHz;
+    };
+
+    void addSegment(SegmentType type, float durationS, const float axis[3], float magnitude, float frequencyHz);
+    float gaussian();
+    float uniform(); // [-1, 1)
+    static int16_t quantize(float value, float resolution);
+
+    float _sampleRateHz;
+    float _dt;
+    float _aRes, _gRes, _mRes;
+    bool _loop = false;
+
+    std::vector<Segment> _segments;
+    size_t _segment = 0;
+    float _segmentT = 0.0f;
+    float _t = 0.0f;
+
+    float _q[4] = {1, 0, 0, 0}; // Orientation, sensor to world (w, x, y, z)
+    float _accelBias[3];
+    float _gyroBias[3];
+
+    uint64_t _rng;
+    bool _haveSpare = false;
+    float _spare = 0.0f;
+};
+
+#endif // MOTION_SIMULATOR_H
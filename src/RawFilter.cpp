@@ -0,0 +1,13 @@
+#include "RawFilter.h"
+#include <cmath>
+
+int RawLowPass::shiftForCutoff(float cutoffHz, float sampleRateHz) {
+    if (cutoffHz <= 0.0f || sampleRateHz <= 0.0f || cutoffHz >= sampleRateHz) {
+        return 0;
+    }
+    float alpha = 1.0f - expf(-2.0f * (float)M_PI * cutoffHz / sampleRateHz);
+    int shift = (int)lroundf(-log2f(alpha));
+    if (shift < 0) shift = 0;
+    if (shift > FRAC_BITS) shift = FRAC_BITS; // Beyond this the output stalls short of small steps
+    return shift;
+}
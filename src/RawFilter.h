@@ -0,0 +1,51 @@
+#ifndef RAW_FILTER_H
+#define RAW_FILTER_H
+
+#include <stdint.h>
+
+// First-order low-pass on 3-axis raw counts, in integer arithmetic only.
+//
+// The state is kept in Q8 (counts * 256) so the filter does not lose the
+// fraction below one count, and the smoothing factor is a power of two so each
+// step is a subtraction and a shift: y += (x - y) >> shift. Input and output
+// stay in the sensor's int16 counts, to compare against thresholds converted
+// with MPU9250::accelThresholdRaw() / gyroThresholdRaw().
+class RawLowPass {
+public:
+    static const int FRAC_BITS = 8;
+
+    // alpha = 2^-shift; shift 0 passes the input through. Keep shift <= FRAC_BITS,
+    // or steps smaller than 2^(shift - FRAC_BITS) counts are never fully followed.
+    explicit RawLowPass(int shift = 3) : _shift(shift) {}
+
+    // Shift whose alpha is closest to a first-order cutoff at a sample rate
+    static int shiftForCutoff(float cutoffHz, float sampleRateHz);
+
+    void reset(const int16_t value[3]) {
+        for (int i = 0; i < 3; i++) {
+            _state[i] = (int32_t)value[i] * (1 << FRAC_BITS);
+        }
+        _primed = true;
+    }
+
+    // Filters one sample in place
+    void process(int16_t value[3]) {
+        if (!_primed) {
+            reset(value);
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            _state[i] += ((int32_t)value[i] * (1 << FRAC_BITS) - _state[i]) >> _shift;
+            value[i] = (int16_t)((_state[i] + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+        }
+    }
+
+    int getShift() const { return _shift; }
+
+private:
+    int _shift;
+    bool _primed = false;
+    int32_t _state[3] = {0, 0, 0}; // Q8
+};
+
+#endif // RAW_FILTER_H
@@ -0,0 +1,167 @@
+#include "Reactor.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+Reactor::Reactor() {
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    _timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    _wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (!ok()) {
+        std::cerr << "ERROR: Failed to create reactor file descriptors." << std::endl;
+        return;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = _timerfd;
+    epoll_ctl(_epfd, EPOLL_CTL_ADD, _timerfd, &ev);
+    ev.data.fd = _wakefd;
+    epoll_ctl(_epfd, EPOLL_CTL_ADD, _wakefd, &ev);
+}
+
+Reactor::~Reactor() {
+    if (_epfd != -1) close(_epfd);
+    if (_timerfd != -1) close(_timerfd);
+    if (_wakefd != -1) close(_wakefd);
+}
+
+void Reactor::spawn(Task task) {
+    task.detach();
+}
+
+void Reactor::run() {
+    epoll_event events[16];
+
+    while (!_stopped && (!_timers.empty() || !_readers.empty())) {
+        armTimer();
+
+        int n = epoll_wait(_epfd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "ERROR: epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        // Collect first: resumed coroutines may register new waits
+        std::vector<std::coroutine_handle<>> ready;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == _wakefd) {
+                uint64_t value;
+                ssize_t r = read(_wakefd, &value, sizeof(value));
+                (void)r;
+            } else if (fd == _timerfd) {
+                uint64_t expirations;
+                ssize_t r = read(_timerfd, &expirations, sizeof(expirations));
+                (void)r;
+            } else {
+                auto it = _readers.find(fd);
+                if (it != _readers.end()) {
+                    ready.push_back(it->second);
+                    _readers.erase(it);
+                }
+            }
+        }
+
+        uint64_t t = now();
+        while (!_timers.empty() && _timers.top().deadlineUs <= t) {
+            ready.push_back(_timers.top().handle);
+            _timers.pop();
+        }
+
+        for (std::coroutine_handle<> h : ready) {
+            if (_stopped) break;
+            h.resume();
+        }
+    }
+}
+
+void Reactor::stop() {
+    _stopped = true;
+    uint64_t one = 1;
+    ssize_t r = write(_wakefd, &one, sizeof(one));
+    (void)r;
+}
+
+uint64_t Reactor::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+void Reactor::resumeAt(uint64_t deadlineUs, std::coroutine_handle<> h) {
+    _timers.push(Timer{deadlineUs, h});
+}
+
+void Reactor::resumeWhenReadable(int fd, std::coroutine_handle<> h) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLPRI | EPOLLONESHOT;
+    ev.data.fd = fd;
+
+    bool known = _registered.count(fd) != 0;
+    if (epoll_ctl(_epfd, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+        std::cerr << "ERROR: Failed to watch fd " << fd << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    _registered.insert(fd);
+    _readers[fd] = h;
+}
+
+void Reactor::armTimer() {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (!_timers.empty()) {
+        uint64_t deadline = _timers.top().deadlineUs;
+        if (deadline == 0) deadline = 1; // A zero it_value would disarm the timer
+        spec.it_value.tv_sec = deadline / 1000000ULL;
+        spec.it_value.tv_nsec = (deadline % 1000000ULL) * 1000ULL;
+    }
+    timerfd_settime(_timerfd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+uint64_t Reactor::GpioEdgeAwaiter::await_resume() {
+    gpioevent_data event;
+    if (read(fd, &event, sizeof(event)) != (ssize_t)sizeof(event)) {
+        return 0;
+    }
+    return event.timestamp;
+}
+
+int Reactor::openGpioEdge(int chip, int line, bool rising, bool falling) {
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/gpiochip%d", chip);
+    int chip_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        std::cerr << "ERROR: Failed to open " << path << "." << std::endl;
+        return -1;
+    }
+
+    gpioevent_request req;
+    memset(&req, 0, sizeof(req));
+    req.lineoffset = line;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags = (rising ? GPIOEVENT_REQUEST_RISING_EDGE : 0) |
+                     (falling ? GPIOEVENT_REQUEST_FALLING_EDGE : 0);
+    snprintf(req.consumer_label, sizeof(req.consumer_label), "satpi");
+
+    int r = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+    close(chip_fd);
+    if (r < 0) {
+        std::cerr << "ERROR: Failed to request edge events on GPIO line " << line << "." << std::endl;
+        return -1;
+    }
+    return req.fd;
+}
@@ -0,0 +1,145 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Coroutine returned by every async function. It starts when awaited, or when
+// handed to Reactor::spawn(), and resumes its awaiter when it finishes.
+class Task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+        bool detached = false;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                promise_type& p = h.promise();
+                if (p.continuation) {
+                    return p.continuation;
+                }
+                if (p.detached) {
+                    h.destroy();
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task(Task&& other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (_handle) _handle.destroy();
+    }
+
+    bool await_ready() { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+        _handle.promise().continuation = awaiter;
+        return _handle;
+    }
+    void await_resume() {}
+
+    // Starts the coroutine and lets it free itself when it finishes
+    void detach() {
+        std::coroutine_handle<promise_type> h = _handle;
+        _handle = nullptr;
+        h.promise().detached = true;
+        h.resume();
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : _handle(h) {}
+    std::coroutine_handle<promise_type> _handle;
+};
+
+
+// Single-threaded epoll event loop. Coroutines suspend on timers, readable file
+// descriptors and GPIO edges, and are resumed from run() on the calling thread.
+class Reactor {
+public:
+    Reactor();
+    ~Reactor();
+
+    bool ok() const { return _epfd != -1 && _timerfd != -1 && _wakefd != -1; }
+
+    void spawn(Task task); // Starts a top-level coroutine owned by the reactor
+    void run();            // Dispatches events until stop() or until nothing is waiting
+    void stop();           // Safe to call from other threads and signal handlers
+
+    static uint64_t now(); // Monotonic clock in microseconds
+
+    // ---- Awaitables ----
+    struct SleepAwaiter {
+        Reactor& reactor;
+        uint64_t deadlineUs;
+        bool await_ready() { return now() >= deadlineUs; }
+        void await_suspend(std::coroutine_handle<> h) { reactor.resumeAt(deadlineUs, h); }
+        void await_resume() {}
+    };
+    SleepAwaiter sleepUntil(uint64_t deadlineUs) { return SleepAwaiter{*this, deadlineUs}; }
+    SleepAwaiter sleepFor(uint32_t us) { return SleepAwaiter{*this, now() + us}; }
+
+    struct ReadableAwaiter {
+        Reactor& reactor;
+        int fd;
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) { reactor.resumeWhenReadable(fd, h); }
+        void await_resume() {}
+    };
+    ReadableAwaiter readable(int fd) { return ReadableAwaiter{*this, fd}; }
+
+    // Waits for an edge on a line opened with openGpioEdge(). Returns the kernel event timestamp in ns.
+    struct GpioEdgeAwaiter {
+        Reactor& reactor;
+        int fd;
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) { reactor.resumeWhenReadable(fd, h); }
+        uint64_t await_resume();
+    };
+    GpioEdgeAwaiter gpioEdge(int fd) { return GpioEdgeAwaiter{*this, fd}; }
+
+    // Requests edge events for a line of /dev/gpiochip<chip> (BCM numbering on the Pi).
+    // Returns a file descriptor for gpioEdge(), or -1 on failure.
+    static int openGpioEdge(int chip, int line, bool rising = true, bool falling = false);
+
+    // ---- Low-level scheduling, used by the awaitables ----
+    void resumeAt(uint64_t deadlineUs, std::coroutine_handle<> h);
+    void resumeWhenReadable(int fd, std::coroutine_handle<> h);
+
+private:
+    struct Timer {
+        uint64_t deadlineUs;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const { return deadlineUs > other.deadlineUs; }
+    };
+
+    void armTimer();
+
+    int _epfd = -1;
+    int _timerfd = -1; // One timerfd armed for the earliest pending timer
+    int _wakefd = -1;  // eventfd used by stop()
+    std::atomic<bool> _stopped{false};
+
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> _timers;
+    std::unordered_map<int, std::coroutine_handle<>> _readers;
+    std::unordered_set<int> _registered; // fds already added to epoll (EPOLLONESHOT, re-armed with MOD)
+};
+
+#endif // REACTOR_H
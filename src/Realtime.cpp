@@ -0,0 +1,107 @@
+#include "Realtime.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void prefaultStack(size_t bytes) {
+    // Touch each page once so the stack is resident before the loop starts
+    volatile unsigned char* stack = (volatile unsigned char*)alloca(bytes);
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+bool setupRealtime(const RealtimeConfig& config) {
+    bool ok = true;
+
+    if (config.lockMemory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cerr << "WARNING: mlockall failed (" << strerror(errno) << "), memory may be paged." << std::endl;
+            ok = false;
+        } else {
+            // Keep freed heap mapped instead of returning it, so later allocations don't fault
+            mallopt(M_TRIM_THRESHOLD, -1);
+            mallopt(M_MMAP_MAX, 0);
+        }
+    }
+
+    if (config.stackPrefaultBytes > 0) {
+        prefaultStack(config.stackPrefaultBytes);
+    }
+
+    if (config.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << "WARNING: Failed to pin thread to CPU " << config.cpu << " (" << strerror(err) << ")." << std::endl;
+            ok = false;
+        }
+    }
+
+    if (config.priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << "WARNING: SCHED_FIFO not available (" << strerror(err) << "), using the default scheduler." << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+PeriodicTimer::PeriodicTimer(uint32_t periodUs) : _periodUs(periodUs) {
+}
+
+void PeriodicTimer::setPeriod(uint32_t periodUs) {
+    _periodUs = periodUs;
+}
+
+void PeriodicTimer::start() {
+    _deadlineNs = monotonicNs() + (uint64_t)_periodUs * 1000ULL;
+}
+
+bool PeriodicTimer::wait() {
+    if (_deadlineNs == 0) {
+        start();
+    }
+
+    uint64_t now = monotonicNs();
+    if (now >= _deadlineNs) {
+        _stats.overruns++;
+        _deadlineNs = now + (uint64_t)_periodUs * 1000ULL;
+        return false;
+    }
+
+    struct timespec ts;
+    ts.tv_sec = _deadlineNs / 1000000000ULL;
+    ts.tv_nsec = _deadlineNs % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+
+    uint32_t latencyUs = (uint32_t)((monotonicNs() - _deadlineNs) / 1000ULL);
+    _stats.wakeups++;
+    _stats.totalLatencyUs += latencyUs;
+    if (latencyUs > _stats.maxLatencyUs) {
+        _stats.maxLatencyUs = latencyUs;
+    }
+
+    _deadlineNs += (uint64_t)_periodUs * 1000ULL;
+    return true;
+}
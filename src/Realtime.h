@@ -0,0 +1,60 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Real-time setup for a timing-critical thread (acquisition loops, stepper pacing)
+struct RealtimeConfig {
+    int priority = 80;                    // SCHED_FIFO priority 1-99, 0 keeps the default scheduler
+    int cpu = -1;                         // Core to pin the thread to, -1 leaves affinity alone
+    bool lockMemory = true;               // mlockall() so page faults can't stall the loop
+    size_t stackPrefaultBytes = 64 * 1024; // Stack touched up front so it is resident
+};
+
+/**
+ * @brief Applies a RealtimeConfig to the calling thread. Each step that fails
+ *        (typically for lack of privileges) is reported and skipped, so the
+ *        program keeps running under the default scheduler.
+ * @return true if every requested setting was applied.
+ */
+bool setupRealtime(const RealtimeConfig& config);
+
+// Wake-up latency and deadline overrun statistics of a PeriodicTimer
+struct TimingStats {
+    uint64_t wakeups = 0;
+    uint64_t overruns = 0;      // Deadlines that had already passed when wait() was called
+    uint32_t maxLatencyUs = 0;  // Worst delay between a deadline and the actual wake-up
+    uint64_t totalLatencyUs = 0;
+
+    float meanLatencyUs() const { return wakeups ? (float)totalLatencyUs / wakeups : 0.0f; }
+};
+
+// Sleeps to absolute CLOCK_MONOTONIC deadlines, so loop jitter doesn't
+// accumulate into drift the way a relative delay() does.
+class PeriodicTimer {
+public:
+    explicit PeriodicTimer(uint32_t periodUs = 1000);
+
+    void setPeriod(uint32_t periodUs);
+    uint32_t getPeriod() const { return _periodUs; }
+
+    void start(); // Anchors the first deadline one period from now
+
+    /**
+     * @brief Sleeps until the next deadline. When a deadline has been missed the
+     *        schedule restarts from now rather than firing back to back.
+     * @return false if the deadline was overrun.
+     */
+    bool wait();
+
+    const TimingStats& getStats() const { return _stats; }
+    void resetStats() { _stats = TimingStats(); }
+
+private:
+    uint32_t _periodUs;
+    uint64_t _deadlineNs = 0;
+    TimingStats _stats;
+};
+
+#endif // REALTIME_H
@@ -0,0 +1,340 @@
+#include "SimulatedMPU9250.h"
+#include "MPU9250_registers.h"
+#include <cstring>
+#include <time.h>
+
+SimulatedMPU9250::SimulatedMPU9250(MotionSimulator& sim) : _sim(sim) {
+    resetDevice();
+    resetMag();
+    _lastUs = nowUs();
+    _nextSampleUs = _lastUs;
+}
+
+// ---- Transport ----
+
+void SimulatedMPU9250::spiTransfer(uint8_t* buf, uint8_t len, uint32_t speedHz) {
+    (void)speedHz;
+    if (len == 0) {
+        return;
+    }
+    catchUp();
+
+    uint8_t reg = buf[0] & 0x7F;
+    bool read = (buf[0] & 0x80) != 0;
+    buf[0] = 0;
+    for (int i = 1; i < len; i++) {
+        if (read) {
+            buf[i] = readRegister(reg);
+        } else {
+            writeRegister(reg, buf[i]);
+        }
+        // Bursts auto-increment, except on FIFO_R_W which keeps draining the FIFO
+        if (reg != FIFO_R_W) {
+            reg = (reg + 1) & 0x7F;
+        }
+    }
+}
+
+uint8_t SimulatedMPU9250::i2cRead(uint8_t address, uint8_t reg) {
+    catchUp();
+    if (address == AK8963_ADDRESS) {
+        // Only reachable while the MPU9250 bypasses its auxiliary bus to the host
+        return (_regs[INT_PIN_CFG] & 0x02) ? readMag(reg) : 0xFF;
+    }
+    return readRegister(reg & 0x7F);
+}
+
+void SimulatedMPU9250::i2cWrite(uint8_t address, uint8_t reg, uint8_t data) {
+    catchUp();
+    if (address == AK8963_ADDRESS) {
+        if (_regs[INT_PIN_CFG] & 0x02) {
+            writeMag(reg, data);
+        }
+        return;
+    }
+    writeRegister(reg & 0x7F, data);
+}
+
+// ---- Time ----
+
+void SimulatedMPU9250::setManualClock(bool manual) {
+    catchUp();
+    _manual = manual;
+    _manualUs = _lastUs;
+}
+
+void SimulatedMPU9250::advance(uint32_t us) {
+    _manualUs += us;
+    catchUp();
+}
+
+uint64_t SimulatedMPU9250::nowUs() {
+    if (_manual) {
+        return _manualUs;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void SimulatedMPU9250::catchUp() {
+    uint64_t now = nowUs();
+    _lastUs = now;
+
+    // After a long gap (a stopped debugger, a paused process) resume instead of replaying it
+    if (now > _nextSampleUs + 1000000) {
+        _nextSampleUs = now;
+    }
+    if (_magRunning && now > _nextMagUs + 1000000) {
+        _nextMagUs = now;
+    }
+
+    // Replay device events in time order
+    bool asleep = (_regs[PWR_MGMT_1] & 0x40) != 0;
+    while (true) {
+        bool sampleDue = !asleep && _nextSampleUs <= now;
+        bool magDue = _magRunning && _nextMagUs <= now;
+        if (magDue && (!sampleDue || _nextMagUs <= _nextSampleUs)) {
+            measureMag();
+        } else if (sampleDue) {
+            takeSample();
+            _nextSampleUs += samplePeriodUs();
+        } else {
+            break;
+        }
+    }
+    if (asleep) {
+        _nextSampleUs = now;
+    }
+}
+
+uint32_t SimulatedMPU9250::samplePeriodUs() {
+    uint8_t dlpf = _regs[CONFIG] & 0x07;
+    if (_regs[GYRO_CONFIG] & 0x03) {
+        return 31; // FCHOICE bypass, 32 kHz
+    }
+    if (dlpf == 0 || dlpf == 7) {
+        return 125; // 8 kHz, SMPLRT_DIV ignored
+    }
+    return 1000 * (1 + _regs[SMPLRT_DIV]);
+}
+
+// ---- Device behaviour ----
+
+void SimulatedMPU9250::takeSample() {
+    RawSample sample;
+    if (_sim.generate(&sample, 1) == 1) {
+        _last = sample;
+    }
+    _samples++;
+
+    // Data registers, big-endian, ACCEL_XOUT_H through GYRO_ZOUT_L
+    int16_t words[7] = {_last.accel[0], _last.accel[1], _last.accel[2], _last.temp,
+                        _last.gyro[0], _last.gyro[1], _last.gyro[2]};
+    for (int i = 0; i < 7; i++) {
+        _regs[ACCEL_XOUT_H + 2 * i] = (uint8_t)((uint16_t)words[i] >> 8);
+        _regs[ACCEL_XOUT_H + 2 * i + 1] = (uint8_t)(words[i] & 0xFF);
+    }
+    _regs[INT_STATUS] |= 0x01; // RAW_DATA_RDY_INT
+
+    // FIFO packets hold the enabled registers in address order
+    if (_regs[USER_CTRL] & 0x40) {
+        uint8_t enable = _regs[FIFO_EN];
+        const uint8_t* data = &_regs[ACCEL_XOUT_H];
+        uint8_t packet[14];
+        int n = 0;
+        if (enable & 0x08) { memcpy(&packet[n], &data[0], 6); n += 6; }  // ACCEL
+        if (enable & 0x80) { memcpy(&packet[n], &data[6], 2); n += 2; }  // TEMP_OUT
+        if (enable & 0x40) { memcpy(&packet[n], &data[8], 2); n += 2; }  // GYRO_XOUT
+        if (enable & 0x20) { memcpy(&packet[n], &data[10], 2); n += 2; } // GYRO_YOUT
+        if (enable & 0x10) { memcpy(&packet[n], &data[12], 2); n += 2; } // GYRO_ZOUT
+        pushFifo(packet, n);
+    }
+
+    // The auxiliary master runs every (1 + I2C_MST_DLY) samples when SLV0 is delayed
+    if (_regs[USER_CTRL] & 0x20) {
+        if (--_auxCountdown <= 0) {
+            auxCycle();
+            _auxCountdown = (_regs[I2C_MST_DELAY_CTRL] & 0x01) ? 1 + (_regs[I2C_SLV4_CTRL] & 0x1F) : 1;
+        }
+    }
+}
+
+void SimulatedMPU9250::pushFifo(const uint8_t* data, int count) {
+    for (int i = 0; i < count; i++) {
+        if (_fifoCount == (int)sizeof(_fifo)) {
+            // Full: the oldest byte is overwritten
+            _fifoHead = (_fifoHead + 1) % (int)sizeof(_fifo);
+            _fifoCount--;
+            _regs[INT_STATUS] |= 0x10; // FIFO_OFLOW_INT
+        }
+        _fifo[(_fifoHead + _fifoCount) % (int)sizeof(_fifo)] = data[i];
+        _fifoCount++;
+    }
+}
+
+void SimulatedMPU9250::auxCycle() {
+    // SLV0 reads len bytes from the magnetometer into EXT_SENS_DATA
+    uint8_t ctrl = _regs[I2C_SLV0_CTRL];
+    uint8_t addr = _regs[I2C_SLV0_ADDR];
+    if (!(ctrl & 0x80) || !(addr & 0x80) || (addr & 0x7F) != AK8963_ADDRESS) {
+        return;
+    }
+    int len = ctrl & 0x0F;
+    for (int i = 0; i < len && EXT_SENS_DATA_00 + i <= EXT_SENS_DATA_23; i++) {
+        _regs[EXT_SENS_DATA_00 + i] = readMag(_regs[I2C_SLV0_REG] + i);
+    }
+}
+
+void SimulatedMPU9250::measureMag() {
+    _magSamples++;
+    for (int i = 0; i < 3; i++) {
+        _mag[AK8963_XOUT_L + 2 * i] = (uint8_t)(_last.mag[i] & 0xFF);
+        _mag[AK8963_XOUT_L + 2 * i + 1] = (uint8_t)((uint16_t)_last.mag[i] >> 8);
+    }
+    _mag[AK8963_ST2] = _mag[AK8963_CNTL] & 0x10; // BITM mirrors the output width
+    if (_mag[AK8963_ST1] & 0x01) {
+        _mag[AK8963_ST1] |= 0x02; // DOR: the previous sample was never read
+    }
+    _mag[AK8963_ST1] |= 0x01;
+
+    switch (_mag[AK8963_CNTL] & 0x0F) {
+        case 0x02: _nextMagUs += 125000; break; // 8 Hz continuous
+        case 0x06: _nextMagUs += 10000; break;  // 100 Hz continuous
+        default:
+            // Single measurement: back to power-down
+            _mag[AK8963_CNTL] &= 0xF0;
+            _magRunning = false;
+            break;
+    }
+}
+
+// ---- Register access ----
+
+uint8_t SimulatedMPU9250::readRegister(uint8_t reg) {
+    uint8_t value = _regs[reg];
+    switch (reg) {
+        case FIFO_COUNTH:
+            return (uint8_t)((_fifoCount >> 8) & 0x1F);
+        case FIFO_COUNTL:
+            return (uint8_t)(_fifoCount & 0xFF);
+        case FIFO_R_W:
+            if (_fifoCount == 0) {
+                return 0;
+            }
+            value = _fifo[_fifoHead];
+            _fifoHead = (_fifoHead + 1) % (int)sizeof(_fifo);
+            _fifoCount--;
+            return value;
+        case INT_STATUS:
+            _regs[INT_STATUS] = 0; // Cleared on read
+            return value;
+        case I2C_MST_STATUS:
+            _regs[I2C_MST_STATUS] &= ~0x40; // I2C_SLV4_DONE clears on read
+            return value;
+        default:
+            return value;
+    }
+}
+
+void SimulatedMPU9250::writeRegister(uint8_t reg, uint8_t data) {
+    switch (reg) {
+        case PWR_MGMT_1:
+            if (data & 0x80) {
+                resetDevice();
+                return;
+            }
+            break;
+        case USER_CTRL:
+            if (data & 0x04) { // FIFO_RST
+                _fifoHead = 0;
+                _fifoCount = 0;
+            }
+            data &= ~0x07; // Reset bits self-clear
+            break;
+        case I2C_SLV4_CTRL:
+            if ((data & 0x80) && (_regs[USER_CTRL] & 0x20)) {
+                // Single transfer, done by the next sample in the real device; done at once here
+                uint8_t addr = _regs[I2C_SLV4_ADDR];
+                if ((addr & 0x7F) == AK8963_ADDRESS) {
+                    if (addr & 0x80) {
+                        _regs[I2C_SLV4_DI] = readMag(_regs[I2C_SLV4_REG]);
+                    } else {
+                        writeMag(_regs[I2C_SLV4_REG], _regs[I2C_SLV4_DO]);
+                    }
+                }
+                _regs[I2C_MST_STATUS] |= 0x40;
+                data &= ~0x80;
+            }
+            break;
+        case FIFO_R_W:
+            pushFifo(&data, 1);
+            return;
+        case WHO_AM_I_MPU9250:
+        case INT_STATUS:
+        case I2C_MST_STATUS:
+            return; // Read-only
+        default:
+            break;
+    }
+    _regs[reg] = data;
+}
+
+uint8_t SimulatedMPU9250::readMag(uint8_t reg) {
+    if (reg >= sizeof(_mag)) {
+        return 0;
+    }
+    uint8_t value = _mag[reg];
+    if (reg == AK8963_ST2) {
+        _mag[AK8963_ST1] &= ~0x03; // Reading ST2 ends the read: DRDY and DOR clear
+    }
+    return value;
+}
+
+void SimulatedMPU9250::writeMag(uint8_t reg, uint8_t data) {
+    if (reg == AK8963_CNTL2) {
+        if (data & 0x01) {
+            resetMag();
+        }
+        return;
+    }
+    if (reg != AK8963_CNTL) {
+        return;
+    }
+    _mag[AK8963_CNTL] = data & 0x1F;
+    switch (data & 0x0F) {
+        case 0x01: // Single measurement, about 7 ms
+            _magRunning = true;
+            _nextMagUs = _lastUs + 7200;
+            break;
+        case 0x02:
+            _magRunning = true;
+            _nextMagUs = _lastUs + 125000;
+            break;
+        case 0x06:
+            _magRunning = true;
+            _nextMagUs = _lastUs + 10000;
+            break;
+        default: // Power-down, self-test and fuse ROM access produce no samples here
+            _magRunning = false;
+            break;
+    }
+}
+
+void SimulatedMPU9250::resetDevice() {
+    memset(_regs, 0, sizeof(_regs));
+    _regs[PWR_MGMT_1] = 0x01;
+    _regs[WHO_AM_I_MPU9250] = 0x71;
+    _fifoHead = 0;
+    _fifoCount = 0;
+    _auxCountdown = 0;
+}
+
+void SimulatedMPU9250::resetMag() {
+    memset(_mag, 0, sizeof(_mag));
+    _mag[AK8963_WHO_AM_I] = 0x48;
+    _mag[AK8963_ASAX] = 128;
+    _mag[AK8963_ASAY] = 128;
+    _mag[AK8963_ASAZ] = 128;
+    _magRunning = false;
+}
@@ -0,0 +1,78 @@
+#ifndef SIMULATED_MPU9250_H
+#define SIMULATED_MPU9250_H
+
+#include "BusTransport.h"
+#include "MotionSimulator.h"
+#include <stdint.h>
+
+// Register-level model of an MPU9250 and its AK8963, fed by a MotionSimulator,
+// to run the driver's bus code without hardware:
+//
+//     SimulatedMPU9250 device(sim);
+//     mpu.setTransport(&device);
+//     mpu.init(AFS_2G, GFS_250DPS, MFS_16BITS, M_100Hz_CONTINUOUS, BUS_SPI);
+//
+// Modelled: sample timing from CONFIG/SMPLRT_DIV/GYRO_CONFIG, data registers,
+// INT_STATUS data ready, the 512-byte FIFO (FIFO_R_W does not auto-increment,
+// overflow drops the oldest bytes), the auxiliary I2C master's SLV0 mirroring
+// and SLV4 single transfers, I2C bypass access to the AK8963, its continuous and
+// single measurement modes, and DRDY/DOR cleared by reading ST2.
+//
+// Not modelled: full-scale and filter settings. One simulator sample is taken
+// per device sample, so configure the simulator with the same rate and scales
+// as the driver. Fuse ROM sensitivity adjustments read as 1.0.
+class SimulatedMPU9250 : public BusTransport {
+public:
+    explicit SimulatedMPU9250(MotionSimulator& sim);
+
+    void spiTransfer(uint8_t* buf, uint8_t len, uint32_t speedHz) override;
+    uint8_t i2cRead(uint8_t address, uint8_t reg) override;
+    void i2cWrite(uint8_t address, uint8_t reg, uint8_t data) override;
+
+    // Time runs on CLOCK_MONOTONIC; with a manual clock it only moves in advance(),
+    // to run faster than real time
+    void setManualClock(bool manual);
+    void advance(uint32_t us);
+
+    uint64_t getSampleCount() const { return _samples; }
+    uint64_t getMagSampleCount() const { return _magSamples; } // AK8963 measurements completed
+
+private:
+    uint64_t nowUs();
+    void catchUp();
+    uint32_t samplePeriodUs();
+    void takeSample();
+    void measureMag();
+    void auxCycle();
+    void pushFifo(const uint8_t* data, int count);
+
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t data);
+    uint8_t readMag(uint8_t reg);
+    void writeMag(uint8_t reg, uint8_t data);
+    void resetDevice();
+    void resetMag();
+
+    MotionSimulator& _sim;
+    RawSample _last = {};
+
+    uint8_t _regs[128];
+    uint8_t _mag[0x13];
+
+    uint8_t _fifo[512];
+    int _fifoHead = 0;
+    int _fifoCount = 0;
+
+    bool _manual = false;
+    uint64_t _manualUs = 0;
+    uint64_t _lastUs = 0;
+    uint64_t _nextSampleUs = 0;
+    uint64_t _nextMagUs = 0;
+    bool _magRunning = false;
+    int _auxCountdown = 0;
+
+    uint64_t _samples = 0;
+    uint64_t _magSamples = 0;
+};
+
+#endif // SIMULATED_MPU9250_H
@@ -0,0 +1,141 @@
+#include "StallMonitor.h"
+#include <cmath>
+#include <cstdlib>
+
+StallMonitor::StallMonitor(float degreesPerStep, int gyroAxis, int gyroSign) {
+    _degreesPerStep = degreesPerStep;
+    _gyroAxis = (gyroAxis >= 0 && gyroAxis < 3) ? gyroAxis : 2;
+    _gyroSign = (gyroSign < 0) ? -1.0f : 1.0f;
+}
+
+void StallMonitor::onStep(int direction, uint32_t timeUs) {
+    if (!_moving) {
+        // A new move: judge it from scratch
+        _moving = true;
+        _commandedDeg = 0.0f;
+        _measuredDeg = 0.0f;
+        _ratio = 1.0f;
+        _count = 0;
+        _state = STALL_TRACKING;
+        _moveStartUs = timeUs;
+        _stepIntervalUs = 0;
+        _stallPending = false;
+    } else {
+        _stepIntervalUs = timeUs - _lastStepUs;
+    }
+    _commandedDeg += (direction > 0) ? _degreesPerStep : -_degreesPerStep;
+    _lastStepUs = timeUs;
+}
+
+StallState StallMonitor::update(const float gyroDps[3], const float accelG[3], uint32_t timeUs) {
+    float dt = _haveUpdate ? (float)(timeUs - _lastUpdateUs) * 1e-6f : 0.0f;
+    if (dt > 0.1f) dt = 0.1f; // A gap in the readings, not a rate to integrate over
+    _lastUpdateUs = timeUs;
+    _haveUpdate = true;
+
+    float rate = gyroDps[_gyroAxis] * _gyroSign;
+    float windowS = windowMs * 1e-3f;
+
+    // Vibration: RMS of the accel magnitude around its slow mean, over about one window
+    if (accelG) {
+        float magnitude = sqrtf(accelG[0] * accelG[0] + accelG[1] * accelG[1] + accelG[2] * accelG[2]);
+        float meanAlpha = fminf(1.0f, dt / 0.2f);
+        float vibrationAlpha = fminf(1.0f, dt / windowS);
+        _accelMean += (magnitude - _accelMean) * meanAlpha;
+        float deviation = magnitude - _accelMean;
+        _vibrationSq += (deviation * deviation - _vibrationSq) * vibrationAlpha;
+        _vibrationG = sqrtf(_vibrationSq);
+    }
+
+    // The move ends once the steps have stopped long enough for the mechanism to settle
+    if (_moving && (int32_t)(timeUs - _lastStepUs) > (int32_t)(idleMs * 1000.0f)) {
+        _moving = false;
+        if (_state == STALL_TRACKING) {
+            _state = STALL_IDLE;
+        }
+    }
+    if (!_moving) {
+        // At rest the gyro reads its bias; a one second time constant rides over noise
+        _bias += (rate - _bias) * fminf(1.0f, dt / 1.0f);
+        return _state;
+    }
+
+    _measuredDeg += (rate - _bias) * dt;
+
+    // Keep the newest snapshot that is at least one window old as the oldest one.
+    // Commanded rotation comes in whole steps, so at slow speeds the window
+    // stretches over several step intervals to compare like with like.
+    uint32_t windowUs = (uint32_t)(windowMs * 1000.0f);
+    if (windowUs < (uint32_t)minWindowSteps * _stepIntervalUs) {
+        windowUs = (uint32_t)minWindowSteps * _stepIntervalUs;
+    }
+    if (_count == HISTORY) {
+        _head = (_head + 1) % HISTORY;
+        _count--;
+    }
+    Snapshot& snap = _history[(_head + _count) % HISTORY];
+    snap.timeUs = timeUs;
+    snap.commandedDeg = _commandedDeg;
+    snap.measuredDeg = _measuredDeg;
+    _count++;
+    while (_count >= 2 && timeUs - _history[(_head + 1) % HISTORY].timeUs >= windowUs) {
+        _head = (_head + 1) % HISTORY;
+        _count--;
+    }
+
+    // Stall check over the window, once the start of the move (the gyro filter's
+    // delay and the rotor's acceleration) has left it
+    const Snapshot& oldest = _history[_head];
+    uint32_t spanUs = timeUs - oldest.timeUs;
+    bool stalled = false;
+    if (spanUs >= windowUs && timeUs - _moveStartUs >= 2 * windowUs) {
+        float commanded = _commandedDeg - oldest.commandedDeg;
+        float measured = _measuredDeg - oldest.measuredDeg;
+        if (fabsf(commanded) >= minRateDps * (float)spanUs * 1e-6f &&
+            fabsf(commanded) >= (minWindowSteps - 0.5f) * _degreesPerStep) {
+            _ratio = measured / commanded;
+            stalled = _ratio < stallRatio &&
+                      (vibrationThresholdG <= 0.0f || !accelG || _vibrationG >= vibrationThresholdG);
+        }
+    }
+
+    // The check must fail for stallHoldMs before a stall is declared
+    if (!stalled) {
+        _stallPending = false;
+    } else if (!_stallPending) {
+        _stallPending = true;
+        _stallSinceUs = timeUs;
+    }
+    bool confirmed = _stallPending && timeUs - _stallSinceUs >= (uint32_t)(stallHoldMs * 1000.0f);
+
+    // A stall sticks until the next move; lost steps can still be caught up with
+    if (confirmed) {
+        _state = STALL_STALLED;
+    } else if (_state != STALL_STALLED) {
+        long lost = getLostSteps();
+        _state = (labs(lost) >= lostStepThreshold) ? STALL_LOST_STEPS : STALL_TRACKING;
+    }
+    return _state;
+}
+
+long StallMonitor::getLostSteps() const {
+    if (_commandedDeg == 0.0f) {
+        return 0;
+    }
+
+    // Under load the rotor lags the field by up to two steps before it slips, so
+    // whole cycles are counted once the gap exceeds three steps
+    float gap = (_commandedDeg - _measuredDeg) / _degreesPerStep;
+    long cycles = (long)floorf((fabsf(gap) + 1.0f) / 4.0f);
+    return (gap < 0.0f) ? -cycles * 4 : cycles * 4;
+}
+
+void StallMonitor::reset() {
+    _state = STALL_IDLE;
+    _moving = false;
+    _commandedDeg = 0.0f;
+    _measuredDeg = 0.0f;
+    _ratio = 1.0f;
+    _count = 0;
+    _stallPending = false;
+}
@@ -0,0 +1,108 @@
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+#include <stdint.h>
+
+enum StallState {
+    STALL_IDLE = 0,   // No steps commanded recently, nothing to judge
+    STALL_TRACKING,   // The mechanism follows the commanded steps
+    STALL_LOST_STEPS, // It moved, but fell behind by at least lostStepThreshold steps
+    STALL_STALLED     // It is not following the steps at all
+};
+
+// Closed-loop check of an open-loop stepper from an IMU on the driven mechanism.
+//
+// Every commanded step advances an expected angle; every gyro reading about the
+// driven axis advances a measured one. Over a sliding window of a few
+// milliseconds, or a few steps at slow speeds, the measured rotation must keep
+// up with the commanded rotation, otherwise the motor is stalled. Over the whole
+// move, the gap between the two angles estimates the steps lost. A stalled rotor
+// also buzzes against its coils, so the accelerometer vibration level can be
+// required as corroboration.
+//
+// Gyro bias is learned while no steps are commanded, so the measured angle does
+// not drift over long moves. All timestamps are micros()-style and may wrap.
+//
+// Feed update() from a sample stream independent of the steps (a sampling thread,
+// the FIFO): sampling once per step locks onto the step phase and turns the
+// per-step velocity ripple into a steady error. The class is not thread-safe;
+// guard onStep() and update() with a lock when they run on different threads.
+class StallMonitor {
+public:
+    /**
+     * @param degreesPerStep Rotation of the driven mechanism per motor step, gearing included.
+     * @param gyroAxis Gyro axis (0-2) aligned with the driven shaft.
+     * @param gyroSign +1 or -1, so forward steps read as positive rotation.
+     */
+    StallMonitor(float degreesPerStep = 360.0f / 2048.0f, int gyroAxis = 2, int gyroSign = 1);
+
+    // Records a commanded step, e.g. from a ULN2003Stepper step listener
+    void onStep(int direction, uint32_t timeUs);
+
+    /**
+     * @brief Feeds one IMU reading and re-evaluates the state.
+     * @param gyroDps Angular rate of each axis in dps, uncompensated or calibrated.
+     * @param accelG Acceleration of each axis in g's, or nullptr to skip the vibration check.
+     */
+    StallState update(const float gyroDps[3], const float accelG[3], uint32_t timeUs);
+
+    StallState getState() const { return _state; }
+
+    // Steps lost since the move started, rounded to whole coil cycles (4 full steps):
+    // a rotor that slips always lands on a position with the same phase. Positive
+    // when the mechanism is behind the commanded position; subtract from it to resync.
+    long getLostSteps() const;
+
+    float getTrackingRatio() const { return _ratio; }  // Measured / commanded rotation over the window
+    float getVibrationG() const { return _vibrationG; } // RMS of the accel magnitude around its mean
+    float getGyroBias() const { return _bias; }         // dps, on the driven axis
+
+    void reset(); // Forgets the move in progress; the learned gyro bias is kept
+
+    // Tuning
+    float windowMs = 10.0f;         // Sliding window of the stall check, at least...
+    int minWindowSteps = 4;         // ...this many step intervals, so slow moves are judged on whole steps
+    float stallRatio = 0.5f;        // Tracking ratio below which the motor is stalled
+    float stallHoldMs = 10.0f;      // How long the ratio must stay below it before the stall latches
+    float minRateDps = 2.0f;        // Slower commanded rates are not judged: the gyro can't tell
+    long lostStepThreshold = 4;
+    float vibrationThresholdG = 0.0f; // Also required for a stall when > 0
+    float idleMs = 50.0f;           // Time without steps after which a move has ended; keep above the slowest step interval
+
+private:
+    struct Snapshot {
+        uint32_t timeUs;
+        float commandedDeg;
+        float measuredDeg;
+    };
+    static const int HISTORY = 512; // About a second of a 500 Hz sample stream
+
+    float _degreesPerStep;
+    int _gyroAxis;
+    float _gyroSign;
+
+    StallState _state = STALL_IDLE;
+    bool _moving = false;
+    uint32_t _moveStartUs = 0;
+    uint32_t _lastStepUs = 0;
+    uint32_t _stepIntervalUs = 0; // Between the last two steps of the move
+    bool _stallPending = false;
+    uint32_t _stallSinceUs = 0;
+    uint32_t _lastUpdateUs = 0;
+    bool _haveUpdate = false;
+
+    float _commandedDeg = 0.0f; // Since the move started
+    float _measuredDeg = 0.0f;
+    float _ratio = 1.0f;
+
+    float _bias = 0.0f;
+    float _accelMean = 1.0f;
+    float _vibrationSq = 0.0f;
+    float _vibrationG = 0.0f;
+
+    Snapshot _history[HISTORY];
+    int _head = 0;  // Oldest snapshot
+    int _count = 0;
+};
+
+#endif // STALL_MONITOR_H
@@ -1,5 +1,6 @@
 #include "Stepper.h"
 #include <wiringPi.h>
+#include <cstdlib>
 
 ULN2003Stepper::ULN2003Stepper(int pin1, int pin2, int pin3, int pin4) {
     pins.push_back(pin1);
@@ -8,6 +9,9 @@ ULN2003Stepper::ULN2003Stepper(int pin1, int pin2, int pin3, int pin4) {
     pins.push_back(pin4);
 
     currentStep = 0;
+    position = 0;
+    step_listener = nullptr;
+    step_listener_context = nullptr;
     steps_per_revolution = 2048;
 
     for (int pin : pins) {
@@ -23,25 +27,63 @@ void ULN2003Stepper::setSpeed(long rpm) {
     }
 }
 
-void ULN2003Stepper::step(int steps) {
+int ULN2003Stepper::step(int steps) {
     int steps_left = abs(steps);
 
+    step_timer.setPeriod(step_delay);
+    step_timer.start();
     while (steps_left > 0) {
-        if (steps > 0) {
-            currentStep++;
-            if (currentStep >= 4) {
-                currentStep = 0;
-            }
-        } else {
-            currentStep--;
-            if (currentStep < 0) {
-                currentStep = 3;
-            }
-        }
-        stepMotor(currentStep);
-        delayMicroseconds(step_delay);
+        bool keep_going = stepOnce(steps);
         steps_left--;
+        if (!keep_going) {
+            break;
+        }
+        step_timer.wait();
+    }
+    return abs(steps) - steps_left;
+}
+
+bool ULN2003Stepper::stepOnce(int direction) {
+    if (direction > 0) {
+        position++;
+        currentStep++;
+        if (currentStep >= 4) {
+            currentStep = 0;
+        }
+    } else {
+        position--;
+        currentStep--;
+        if (currentStep < 0) {
+            currentStep = 3;
+        }
     }
+    stepMotor(currentStep);
+
+    if (step_listener) {
+        return step_listener(direction > 0 ? 1 : -1, step_listener_context);
+    }
+    return true;
+}
+
+void ULN2003Stepper::setStepListener(StepListener listener, void* context) {
+    step_listener = listener;
+    step_listener_context = context;
+}
+
+long ULN2003Stepper::getPosition() const {
+    return position;
+}
+
+void ULN2003Stepper::setPosition(long new_position) {
+    position = new_position;
+}
+
+long ULN2003Stepper::getStepDelay() const {
+    return step_delay;
+}
+
+const TimingStats& ULN2003Stepper::getTimingStats() const {
+    return step_timer.getStats();
 }
 
 void ULN2003Stepper::stepMotor(int thisStep) {
@@ -1,7 +1,12 @@
-}#ifndef ULN2003STEPPER_H
+#ifndef ULN2003STEPPER_H
 #define ULN2003STEPPER_H
 
 #include <vector>
+#include "Realtime.h"
+
+// Called after every step with the direction taken; returning false stops the
+// move in progress (see step() and stepAsync())
+typedef bool (*StepListener)(int direction, void* context);
 
 class ULN2003Stepper {
 public:
@@ -23,8 +28,46 @@ public:
     /**
      * @brief Moves the motor a specific number of steps.
      * @param steps The number of steps to move. Positive for forward, negative for backward.
+     * @return The number of steps taken, fewer than requested if the step listener stopped the move.
+     */
+    int step(int steps);
+
+    /**
+     * @brief Advances the coil sequence by a single step without waiting.
+     *        The caller is responsible for pacing calls by getStepDelay().
+     * @param direction Positive for forward, negative for backward.
+     * @return false if the step listener asked to stop moving.
+     */
+    bool stepOnce(int direction);
+
+    /**
+     * @brief Installs a function called after every step, e.g. to check for stalls.
+     * @param listener The function, or nullptr to remove it.
+     * @param context Passed back to the listener unchanged.
+     */
+    void setStepListener(StepListener listener, void* context);
+
+    /**
+     * @brief Returns the commanded position: the sum of all steps taken.
+     */
+    long getPosition() const;
+
+    /**
+     * @brief Redefines the commanded position, after homing or to account for lost steps.
+     * @param position The new position in steps.
+     */
+    void setPosition(long position);
+
+    /**
+     * @brief Returns the delay between steps for the current speed.
+     * @return The step delay in microseconds.
+     */
+    long getStepDelay() const;
+
+    /**
+     * @brief Returns wake-up latency and missed step deadlines accumulated by step().
      */
-    void step(int steps);
+    const TimingStats& getTimingStats() const;
 
     /**
      * @brief Stops the motor and turns off all coils to save power.
@@ -36,8 +79,12 @@ private:
 
     std::vector<int> pins;
     int currentStep;
+    long position;
+    StepListener step_listener;
+    void* step_listener_context;
     long step_delay; // in microseconds
     int steps_per_revolution;
+    PeriodicTimer step_timer; // Paces step() on absolute deadlines
 
     // Step sequence for full-step mode
     const int step_sequence[4][4] = {
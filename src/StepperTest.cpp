@@ -1,6 +1,7 @@
 #include <iostream>
 #include <wiringPi.h>
-#include "ULN2003Stepper.h"
+#include "Stepper.h"
+#include "Realtime.h"
 
 #define IN1 0   //Board pin 11 
 #define IN2 2   //Board pin 13
@@ -15,6 +16,11 @@ int main() {
 
     std::cout << "Control de Motor Paso a Paso con ULN2003" << std::endl;
 
+    // Prioridad de tiempo real para evitar tirones en los pasos (requiere root)
+    RealtimeConfig rt;
+    rt.cpu = 3;
+    setupRealtime(rt);
+
     ULN2003Stepper myStepper(IN1, IN2, IN3, IN4);
 
     myStepper.setSpeed(15);
@@ -23,7 +29,12 @@ int main() {
     std::cout << "Presiona Ctrl+C para detener." << std::endl;
 
     while (true) {
-        myStepper.step(1);
+        myStepper.step(2048);
+
+        const TimingStats& stats = myStepper.getTimingStats();
+        std::cout << "Latencia media: " << stats.meanLatencyUs() << " us | "
+                  << "max: " << stats.maxLatencyUs << " us | "
+                  << "pasos atrasados: " << stats.overruns << std::endl;
     }
     myStepper.stop();
 
@@ -0,0 +1,254 @@
+#include "TempCompensation.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+TempCompensation::TempCompensation(float minTempC, float maxTempC, float stepC) {
+    _minTempC = minTempC;
+    _stepC = (stepC > 0.0f) ? stepC : 1.0f;
+    _numNodes = (int)floorf((maxTempC - minTempC) / _stepC) + 1;
+    if (_numNodes < 2) _numNodes = 2;
+    if (_numNodes > MAX_NODES) _numNodes = MAX_NODES;
+
+    memset(_intervals, 0, sizeof(_intervals));
+    memset(_bias, 0, sizeof(_bias));
+    resetWindow();
+}
+
+bool TempCompensation::learn(const float accel[3], const float gyro[3], float temperature) {
+    float values[AXES] = {accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2]};
+    if (!std::isfinite(temperature)) {
+        return false;
+    }
+    for (int i = 0; i < AXES; i++) {
+        if (!std::isfinite(values[i])) {
+            return false;
+        }
+    }
+    for (int i = 0; i < AXES; i++) {
+        _sum[i] += values[i];
+        _sumSq[i] += (double)values[i] * values[i];
+    }
+    if (temperature < _tempMin) _tempMin = temperature;
+    if (temperature > _tempMax) _tempMax = temperature;
+    _tempSum += temperature;
+
+    if (++_count < windowSamples) {
+        return false;
+    }
+
+    // Check that the window was stationary
+    float mean[AXES];
+    bool stationary = (_tempMax - _tempMin) <= maxTempSpreadC;
+    for (int i = 0; i < AXES && stationary; i++) {
+        mean[i] = (float)(_sum[i] / _count);
+        double var = _sumSq[i] / _count - (double)mean[i] * mean[i];
+        float maxStd = (i < 3) ? maxAccelStdG : maxGyroStdDps;
+        stationary = var <= (double)maxStd * maxStd;
+    }
+    float temp = (float)(_tempSum / _count);
+    resetWindow();
+
+    // A resting gyro reads its bias; a resting accelerometer reads its bias plus 1g on Z
+    if (!stationary || fabsf(fabsf(mean[2]) - 1.0f) > 0.1f) {
+        return false;
+    }
+    mean[2] -= (mean[2] > 0.0f) ? 1.0f : -1.0f;
+
+    // A steady rotation is as quiet as a resting gyro: only take gyro means close
+    // to the current estimate, or to the reference before anything is learned
+    float predictedAccel[3], predictedGyro[3];
+    const float* expected = nullptr;
+    if (getBias(temp, predictedAccel, predictedGyro)) {
+        expected = predictedGyro;
+    } else if (_haveReference) {
+        expected = _referenceGyro;
+    }
+    for (int i = 0; expected && i < 3; i++) {
+        if (fabsf(mean[3 + i] - expected[i]) > maxBiasJumpDps) {
+            return false;
+        }
+    }
+
+    // Locate the interval and the window's basis weights on its two nodes
+    float x = (temp - _minTempC) / _stepC;
+    if (x < 0.0f) x = 0.0f;
+    if (x > _numNodes - 1) x = (float)(_numNodes - 1);
+    int k = (int)x;
+    if (k > _numNodes - 2) k = _numNodes - 2;
+    float w1 = x - k;
+    float w0 = 1.0f - w1;
+
+    Interval& in = _intervals[k];
+    float windows = in.s00 + 2.0f * in.s01 + in.s11; // (w0 + w1)^2 = 1 per window
+    if (windows >= maxIntervalWindows) {
+        float decay = (maxIntervalWindows - 1.0f) / windows;
+        in.s00 *= decay;
+        in.s01 *= decay;
+        in.s11 *= decay;
+        for (int i = 0; i < AXES; i++) {
+            in.r0[i] *= decay;
+            in.r1[i] *= decay;
+        }
+    }
+    in.s00 += w0 * w0;
+    in.s01 += w0 * w1;
+    in.s11 += w1 * w1;
+    for (int i = 0; i < AXES; i++) {
+        in.r0[i] += w0 * mean[i];
+        in.r1[i] += w1 * mean[i];
+    }
+
+    solve();
+    return true;
+}
+
+bool TempCompensation::getBias(float temperature, float accelBias[3], float gyroBias[3]) const {
+    if (_trainedNodes == 0 || !std::isfinite(temperature)) {
+        return false;
+    }
+
+    float x = (temperature - _minTempC) / _stepC;
+    if (x < 0.0f) x = 0.0f;
+    if (x > _numNodes - 1) x = (float)(_numNodes - 1);
+    int i0 = (int)x;
+    if (i0 > _numNodes - 2) i0 = _numNodes - 2;
+    float f = x - i0;
+
+    const float* a = _bias[i0];
+    const float* b = _bias[i0 + 1];
+    accelBias[0] = a[0] + f * (b[0] - a[0]);
+    accelBias[1] = a[1] + f * (b[1] - a[1]);
+    accelBias[2] = a[2] + f * (b[2] - a[2]);
+    gyroBias[0]  = a[3] + f * (b[3] - a[3]);
+    gyroBias[1]  = a[4] + f * (b[4] - a[4]);
+    gyroBias[2]  = a[5] + f * (b[5] - a[5]);
+    return true;
+}
+
+void TempCompensation::setReferenceBias(const float gyroBias[3]) {
+    for (int i = 0; i < 3; i++) {
+        _referenceGyro[i] = gyroBias[i];
+    }
+    _haveReference = true;
+}
+
+bool TempCompensation::save(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        std::cerr << "ERROR: Failed to open " << path << " for writing." << std::endl;
+        return false;
+    }
+
+    fprintf(file, "tempcomp 1 %g %g %d\n", _minTempC, _stepC, _numNodes);
+    for (int k = 0; k < _numNodes - 1; k++) {
+        const Interval& in = _intervals[k];
+        fprintf(file, "%.7g %.7g %.7g", in.s00, in.s01, in.s11);
+        for (int i = 0; i < AXES; i++) {
+            fprintf(file, " %.7g %.7g", in.r0[i], in.r1[i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool TempCompensation::load(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    int version = 0, numNodes = 0;
+    float minTempC = 0, stepC = 0;
+    if (fscanf(file, "tempcomp %d %f %f %d", &version, &minTempC, &stepC, &numNodes) != 4 ||
+        version != 1 || numNodes != _numNodes ||
+        fabsf(minTempC - _minTempC) > 1e-3f || fabsf(stepC - _stepC) > 1e-3f) {
+        std::cerr << "ERROR: " << path << " does not match this temperature grid." << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    Interval intervals[MAX_NODES - 1];
+    bool ok = true;
+    for (int k = 0; k < _numNodes - 1 && ok; k++) {
+        Interval& in = intervals[k];
+        ok = fscanf(file, "%f %f %f", &in.s00, &in.s01, &in.s11) == 3;
+        for (int i = 0; i < AXES && ok; i++) {
+            ok = fscanf(file, "%f %f", &in.r0[i], &in.r1[i]) == 2;
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        std::cerr << "ERROR: " << path << " is truncated." << std::endl;
+        return false;
+    }
+
+    memcpy(_intervals, intervals, sizeof(Interval) * (_numNodes - 1));
+    solve();
+    return true;
+}
+
+void TempCompensation::resetWindow() {
+    _count = 0;
+    memset(_sum, 0, sizeof(_sum));
+    memset(_sumSq, 0, sizeof(_sumSq));
+    _tempMin = INFINITY;
+    _tempMax = -INFINITY;
+    _tempSum = 0.0;
+}
+
+void TempCompensation::solve() {
+    // Assemble the tridiagonal normal equations of the piecewise-linear fit, plus a
+    // small penalty on the difference between neighbouring nodes. The penalty keeps
+    // nodes without data solvable by carrying the nearest data flat or linearly
+    // across them, and costs nothing for a flat bias, so a model learned at a
+    // single temperature returns exactly the measured bias.
+    const double smoothing = 1e-3;
+    double diag[MAX_NODES], off[MAX_NODES], rhs[MAX_NODES][AXES];
+    _trainedNodes = 0;
+    for (int n = 0; n < _numNodes; n++) {
+        const Interval* left = (n > 0) ? &_intervals[n - 1] : nullptr;
+        const Interval* right = (n < _numNodes - 1) ? &_intervals[n] : nullptr;
+        double support = (left ? left->s11 : 0.0f) + (right ? right->s00 : 0.0f);
+        if (support > 0.0) _trainedNodes++;
+
+        diag[n] = support + (left ? smoothing : 0.0) + (right ? smoothing : 0.0);
+        off[n] = right ? right->s01 - smoothing : 0.0;
+        for (int i = 0; i < AXES; i++) {
+            rhs[n][i] = (left ? left->r1[i] : 0.0f) + (right ? right->r0[i] : 0.0f);
+        }
+    }
+    if (_trainedNodes == 0) {
+        // Without data the penalty alone leaves the level undetermined
+        memset(_bias, 0, sizeof(_bias));
+        return;
+    }
+
+    // Thomas algorithm, all axes at once
+    double c[MAX_NODES], d[MAX_NODES][AXES];
+    c[0] = off[0] / diag[0];
+    for (int i = 0; i < AXES; i++) {
+        d[0][i] = rhs[0][i] / diag[0];
+    }
+    for (int n = 1; n < _numNodes; n++) {
+        double m = diag[n] - off[n - 1] * c[n - 1];
+        c[n] = off[n] / m;
+        for (int i = 0; i < AXES; i++) {
+            d[n][i] = (rhs[n][i] - off[n - 1] * d[n - 1][i]) / m;
+        }
+    }
+    for (int n = _numNodes - 2; n >= 0; n--) {
+        for (int i = 0; i < AXES; i++) {
+            d[n][i] -= c[n] * d[n + 1][i];
+        }
+    }
+    for (int n = 0; n < _numNodes; n++) {
+        for (int i = 0; i < AXES; i++) {
+            _bias[n][i] = (float)d[n][i];
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef TEMP_COMPENSATION_H
+#define TEMP_COMPENSATION_H
+
+#include <stdint.h>
+
+// Online model of accelerometer and gyroscope bias versus temperature.
+//
+// The bias of each axis is a piecewise-linear function of temperature over a
+// fixed grid of nodes. Stationary periods are detected from the sample stream;
+// each one adds to the least-squares statistics of the grid interval containing
+// its temperature, and the node values are re-solved from those statistics,
+// with a light smoothness penalty that holds the fit flat beyond the learned
+// temperatures and linear between them.
+// The model can be saved and reloaded, so biases keep tracking temperature
+// across restarts without recalibration stops. Lookups are O(1): one grid index
+// and one interpolation.
+//
+// As with MPU9250::calibrate(), accelerometer bias assumes the unit is mounted
+// flat with gravity on the Z axis.
+class TempCompensation {
+public:
+    static const int MAX_NODES = 32;
+    static const int AXES = 6; // ax, ay, az, gx, gy, gz
+
+    /**
+     * @param minTempC Temperature of the first node.
+     * @param maxTempC Temperature of the last node (the grid is capped at MAX_NODES).
+     * @param stepC Spacing between nodes.
+     */
+    TempCompensation(float minTempC = -20.0f, float maxTempC = 70.0f, float stepC = 5.0f);
+
+    /**
+     * @brief Feeds one uncompensated sample (no bias removed) for learning.
+     *        Samples with non-finite values are ignored.
+     * @param accel Acceleration in g's.
+     * @param gyro Angular rate in dps.
+     * @param temperature Die temperature in degrees Celsius.
+     * @return true if this sample completed a stationary window that updated the model.
+     */
+    bool learn(const float accel[3], const float gyro[3], float temperature);
+
+    /**
+     * @brief Interpolates the bias at a temperature.
+     * @return false, leaving the outputs untouched, if nothing has been learned yet
+     *         or the temperature is not finite.
+     */
+    bool getBias(float temperature, float accelBias[3], float gyroBias[3]) const;
+
+    bool isTrained() const { return _trainedNodes > 0; }
+
+    // Gyro bias the first windows are checked against until the model has learned
+    // its own, e.g. from MPU9250::calibrate(). Without one, they are taken as is.
+    void setReferenceBias(const float gyroBias[3]);
+
+    bool save(const char* path) const;
+    bool load(const char* path); // Fails if the file was saved with a different grid
+
+    // Stationarity detection
+    int windowSamples = 200;      // Samples averaged per stationary window
+    float maxGyroStdDps = 0.3f;   // Per-axis standard deviation allowed while stationary
+    float maxAccelStdG = 0.01f;
+    float maxTempSpreadC = 0.5f;  // Windows spanning more than this are discarded
+    float maxIntervalWindows = 50.0f; // Caps an interval's history so old windows age out
+    float maxBiasJumpDps = 1.0f;  // Gyro means further than this from the estimate are rotation, not bias
+
+private:
+    void resetWindow();
+    void solve();
+
+    float _minTempC;
+    float _stepC;
+    int _numNodes;
+    int _trainedNodes = 0;
+    float _referenceGyro[3] = {0, 0, 0};
+    bool _haveReference = false;
+
+    // Least-squares statistics per interval between node k and k+1, where a window
+    // at fraction f of the interval has basis weights (1 - f, f)
+    struct Interval {
+        float s00, s01, s11;  // Sums of w0*w0, w0*w1, w1*w1
+        float r0[AXES];       // Sums of w0*bias
+        float r1[AXES];       // Sums of w1*bias
+    };
+    Interval _intervals[MAX_NODES - 1];
+
+    // Solved node values; nodes without data follow their neighbours
+    float _bias[MAX_NODES][AXES];
+
+    // Current window accumulators
+    int _count = 0;
+    double _sum[AXES];
+    double _sumSq[AXES];
+    float _tempMin, _tempMax;
+    double _tempSum;
+};
+
+#endif // TEMP_COMPENSATION_H
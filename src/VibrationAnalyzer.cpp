@@ -0,0 +1,195 @@
+#include "VibrationAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+VibrationAnalyzer::VibrationAnalyzer(float sampleRateHz, int fftSize, int averages) {
+    _sampleRateHz = sampleRateHz;
+    _fftSize = 2;
+    while (_fftSize < fftSize) {
+        _fftSize <<= 1;
+    }
+    _numBins = _fftSize / 2 + 1;
+    _averages = averages < 0 ? 0 : averages;
+
+    _input.assign(3 * _fftSize, 0.0f);
+    _psd.assign(3 * _numBins, 0.0f);
+    _work.resize(_fftSize);
+
+    // Hann window; the PSD is normalized by its power so it reads in g^2/Hz
+    _window.resize(_fftSize);
+    float windowPower = 0.0f;
+    for (int n = 0; n < _fftSize; n++) {
+        _window[n] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / _fftSize);
+        windowPower += _window[n] * _window[n];
+    }
+    _psdScale = 1.0f / (_sampleRateHz * windowPower);
+
+    _twiddles.resize(_fftSize / 2);
+    for (int k = 0; k < _fftSize / 2; k++) {
+        _twiddles[k] = std::polar(1.0f, -2.0f * (float)M_PI * k / _fftSize);
+    }
+
+    int bits = 0;
+    while ((1 << bits) < _fftSize) {
+        bits++;
+    }
+    _bitReverse.resize(_fftSize);
+    for (int i = 0; i < _fftSize; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        _bitReverse[i] = r;
+    }
+}
+
+void VibrationAnalyzer::process(const ImuSample* samples, int count) {
+    for (int i = 0; i < count; i++) {
+        _input[_fill] = samples[i].ax;
+        _input[_fftSize + _fill] = samples[i].ay;
+        _input[2 * _fftSize + _fill] = samples[i].az;
+
+        if (++_fill == _fftSize) {
+            analyzeSegment();
+
+            // 50% overlap: the second half starts the next segment
+            int half = _fftSize / 2;
+            for (int axis = 0; axis < 3; axis++) {
+                float* in = &_input[axis * _fftSize];
+                memmove(in, in + half, half * sizeof(float));
+            }
+            _fill = half;
+        }
+    }
+}
+
+void VibrationAnalyzer::reset() {
+    std::fill(_psd.begin(), _psd.end(), 0.0f);
+    _segments = 0;
+    _fill = 0;
+}
+
+int VibrationAnalyzer::addBand(float lowHz, float highHz) {
+    if (_numBands >= MAX_BANDS) {
+        return -1;
+    }
+    float binHz = getBinHz();
+    Band& band = _bands[_numBands];
+    band.firstBin = std::min(_numBins, std::max(0, (int)ceilf(lowHz / binHz)));
+    band.lastBin = std::min(_numBins, std::max(band.firstBin, (int)ceilf(highHz / binHz)));
+    return _numBands++;
+}
+
+float VibrationAnalyzer::getBandEnergy(int band, int axis) const {
+    if (band < 0 || band >= _numBands) {
+        return 0.0f;
+    }
+    const float* psd = getPsd(axis);
+    float sum = 0.0f;
+    for (int k = _bands[band].firstBin; k < _bands[band].lastBin; k++) {
+        sum += psd[k];
+    }
+    return sum * getBinHz();
+}
+
+int VibrationAnalyzer::getPeaks(int axis, SpectralPeak* dest, int maxPeaks) const {
+    const float* psd = getPsd(axis);
+    int found = 0;
+    if (maxPeaks <= 0) {
+        return 0;
+    }
+
+    for (int k = 1; k < _numBins - 1; k++) {
+        float a = psd[k - 1], b = psd[k], c = psd[k + 1];
+        if (!(b > a && b >= c)) {
+            continue;
+        }
+        if (found == maxPeaks && b <= dest[found - 1].psd) {
+            continue;
+        }
+
+        // Parabolic interpolation of the true peak position between bins
+        float denom = a - 2.0f * b + c;
+        float delta = (denom != 0.0f) ? 0.5f * (a - c) / denom : 0.0f;
+        SpectralPeak peak = {(k + delta) * getBinHz(), b};
+
+        // Insert keeping dest sorted, strongest first
+        int pos = (found < maxPeaks) ? found++ : maxPeaks - 1;
+        while (pos > 0 && dest[pos - 1].psd < peak.psd) {
+            dest[pos] = dest[pos - 1];
+            pos--;
+        }
+        dest[pos] = peak;
+    }
+    return found;
+}
+
+void VibrationAnalyzer::analyzeSegment() {
+    const float* x = &_input[0];
+    const float* y = &_input[_fftSize];
+    const float* z = &_input[2 * _fftSize];
+
+    // Remove each axis' mean (gravity and bias) so it doesn't leak into the low bins
+    float mean[3] = {0, 0, 0};
+    for (int n = 0; n < _fftSize; n++) {
+        mean[0] += x[n];
+        mean[1] += y[n];
+        mean[2] += z[n];
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        mean[axis] /= _fftSize;
+    }
+
+    _segments++;
+    float alpha = (_averages == 0 || _segments <= _averages) ? 1.0f / _segments : 1.0f / _averages;
+    float* psdX = &_psd[0];
+    float* psdY = &_psd[_numBins];
+    float* psdZ = &_psd[2 * _numBins];
+
+    // X and Y share one complex FFT as its real and imaginary parts
+    for (int n = 0; n < _fftSize; n++) {
+        _work[n] = std::complex<float>((x[n] - mean[0]) * _window[n], (y[n] - mean[1]) * _window[n]);
+    }
+    fft(&_work[0]);
+    for (int k = 0; k < _numBins; k++) {
+        std::complex<float> a = _work[k];
+        std::complex<float> b = std::conj(_work[(_fftSize - k) % _fftSize]);
+        float scale = (k == 0 || k == _fftSize / 2) ? _psdScale : 2.0f * _psdScale;
+        float px = std::norm(a + b) * 0.25f * scale;
+        float py = std::norm(a - b) * 0.25f * scale;
+        psdX[k] += alpha * (px - psdX[k]);
+        psdY[k] += alpha * (py - psdY[k]);
+    }
+
+    for (int n = 0; n < _fftSize; n++) {
+        _work[n] = std::complex<float>((z[n] - mean[2]) * _window[n], 0.0f);
+    }
+    fft(&_work[0]);
+    for (int k = 0; k < _numBins; k++) {
+        float scale = (k == 0 || k == _fftSize / 2) ? _psdScale : 2.0f * _psdScale;
+        psdZ[k] += alpha * (std::norm(_work[k]) * scale - psdZ[k]);
+    }
+}
+
+void VibrationAnalyzer::fft(std::complex<float>* data) {
+    // Iterative radix-2 decimation in time
+    for (int i = 0; i < _fftSize; i++) {
+        int j = _bitReverse[i];
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (int len = 2; len <= _fftSize; len <<= 1) {
+        int half = len / 2;
+        int stride = _fftSize / len;
+        for (int start = 0; start < _fftSize; start += len) {
+            for (int k = 0; k < half; k++) {
+                std::complex<float> t = _twiddles[k * stride] * data[start + k + half];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
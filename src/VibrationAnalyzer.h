@@ -0,0 +1,86 @@
+#ifndef VIBRATION_ANALYZER_H
+#define VIBRATION_ANALYZER_H
+
+#include "MPU9250.h"
+#include <complex>
+#include <vector>
+
+// A spectral peak found by VibrationAnalyzer::getPeaks()
+struct SpectralPeak {
+    float frequencyHz; // Interpolated between bins
+    float psd;         // g^2/Hz at the peak bin
+};
+
+// On-device vibration spectrum of the accelerometer stream, for condition monitoring.
+//
+// Maintains a Welch power spectral density per axis: Hann-windowed segments of
+// fftSize samples with 50% overlap, averaged as they complete. Samples are fed
+// in FIFO batches and an FFT runs each time half a segment has accumulated, so
+// the work is spread across batches. All buffers are allocated in the constructor.
+class VibrationAnalyzer {
+public:
+    static const int MAX_BANDS = 8;
+
+    /**
+     * @param sampleRateHz Rate of the accelerometer stream.
+     * @param fftSize Segment length; rounded up to a power of two.
+     * @param averages Segments averaged linearly before switching to an exponential
+     *        average over the same number of segments, so the spectrum follows
+     *        slowly changing machinery. 0 keeps a linear average until reset().
+     */
+    VibrationAnalyzer(float sampleRateHz, int fftSize = 256, int averages = 16);
+
+    // Feeds a batch of samples; only the accelerometer axes are used
+    void process(const ImuSample* samples, int count);
+
+    void reset(); // Discards the accumulated spectrum and any partial segment
+
+    // Registers a frequency band for getBandEnergy(). Returns its index, or -1 if full.
+    int addBand(float lowHz, float highHz);
+
+    /**
+     * @brief Energy in a band: the PSD integrated over [lowHz, highHz).
+     * @param band Index returned by addBand().
+     * @param axis 0, 1 or 2 for X, Y, Z.
+     * @return Mean square acceleration in the band, in g^2.
+     */
+    float getBandEnergy(int band, int axis) const;
+
+    /**
+     * @brief Finds the strongest local maxima of an axis' spectrum, strongest first.
+     * @return The number of peaks written to dest.
+     */
+    int getPeaks(int axis, SpectralPeak* dest, int maxPeaks) const;
+
+    const float* getPsd(int axis) const { return &_psd[axis * _numBins]; } // g^2/Hz per bin
+    int getNumBins() const { return _numBins; }
+    float getBinHz() const { return _sampleRateHz / _fftSize; }
+    int getSegmentCount() const { return _segments; }
+
+private:
+    void analyzeSegment();
+    void fft(std::complex<float>* data);
+
+    float _sampleRateHz;
+    int _fftSize;
+    int _numBins;  // fftSize / 2 + 1, DC to Nyquist
+    int _averages;
+    int _segments = 0;
+    int _fill = 0; // Samples in the current segment
+
+    std::vector<float> _input;    // 3 axes of fftSize samples
+    std::vector<float> _window;
+    float _psdScale;              // Converts |X|^2 to a one-sided g^2/Hz
+    std::vector<float> _psd;      // 3 axes of _numBins
+    std::vector<std::complex<float>> _work;
+    std::vector<std::complex<float>> _twiddles;
+    std::vector<int> _bitReverse;
+
+    struct Band {
+        int firstBin, lastBin; // Inclusive, exclusive
+    };
+    Band _bands[MAX_BANDS];
+    int _numBands = 0;
+};
+
+#endif // VIBRATION_ANALYZER_H
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <cmath> // Required for abs()
 #include <iomanip> // Required for std::fixed, std::setprecision
 #include <wiringPi.h>
 #include "MPU9250.h"
@@ -19,20 +18,27 @@ int main() {
     // Calibrate the sensor for more accurate readings
     mpu.calibrate();
 
+    // Only the accelerometer is needed: skip reading the other channels
+    mpu.setChannelRates(0, -1, -1, -1);
+
+    // Convert the threshold to raw counts once, instead of every sample to g's
+    const int16_t zHigh = mpu.accelThresholdRaw(2, 1.0f);
+    const int16_t zLow = mpu.accelThresholdRaw(2, -1.0f);
+
     std::cout << "Polling for motion on Y-axis greater than 1g..." << std::endl;
 
     // Main loop for software polling
     while (1) {
-        // Always read the latest sensor data in the loop
-        mpu.update();
+        // Always read the latest sensor data in the loop, as raw counts
+        mpu.updateRaw();
 
-        // Check if the absolute value of Y-axis acceleration is greater than 1.0g
-        if (std::abs(mpu.az) > 1.0f) {
+        // Check if the absolute value of Z-axis acceleration is greater than 1.0g
+        if (mpu.raw.accel[2] > zHigh || mpu.raw.accel[2] < zLow) {
             std::cout << "\nMotion Detected on z-axis!" << std::endl;
             
             // Print the value that triggered the detection
             std::cout << std::fixed << std::setprecision(3);
-            std::cout << "z-axis acceleration: " << mpu.az << " g" << std::endl;
+            std::cout << "z-axis acceleration: " << mpu.accelG(2) << " g" << std::endl;
             
             // Wait for 2 seconds before continuing to avoid spamming the console
             delay(2000); 
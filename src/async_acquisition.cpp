@@ -0,0 +1,76 @@
+#include <iostream>
+#include <iomanip> // For std::fixed and std::setprecision
+#include <csignal>
+#include <wiringPi.h>
+#include "AsyncMPU9250.h"
+#include "AsyncStepper.h"
+#include "Decimator.h"
+
+#define IN1 0   //Board pin 11
+#define IN2 2   //Board pin 13
+#define IN3 3   //Board pin 15
+#define IN4 4   //Board pin 16
+
+static Reactor* g_reactor = nullptr;
+
+static void onSignal(int) {
+    if (g_reactor) g_reactor->stop();
+}
+
+// Drains the IMU FIFO every 10 ms and prints the stream low-pass filtered down to 20 Hz
+Task readImu(AsyncMPU9250& imu, Decimator& decimator) {
+    ImuSample out[MPU9250::FIFO_MAX_SAMPLES];
+    while (true) {
+        ImuBatch batch = co_await imu.nextBatch();
+        int n = decimator.process(batch.samples, batch.count, out);
+
+        std::cout << std::fixed << std::setprecision(3);
+        for (int i = 0; i < n; i++) {
+            std::cout << "Z accel=" << std::setw(6) << out[i].az << " g | "
+                      << "Z gyro=" << std::setw(8) << out[i].gz << " dps" << std::endl;
+        }
+    }
+}
+
+// Turns the motor back and forth on the same thread as the IMU
+Task spinMotor(Reactor& reactor, ULN2003Stepper& stepper) {
+    while (true) {
+        co_await stepAsync(reactor, stepper, 2048);
+        co_await stepAsync(reactor, stepper, -2048);
+    }
+}
+
+int main(void) {
+    MPU9250 mpu;
+    // SPI: each FIFO drain blocks the loop thread, and on I2C draining 1 kHz of
+    // accel/gyro one register read at a time would stall the motor's steps
+    if (!mpu.init(AFS_2G, GFS_250DPS, MFS_16BITS, M_100Hz_CONTINUOUS, BUS_SPI)) {
+        std::cerr << "Failed to initialize MPU9250. Please check connections." << std::endl;
+        return -1;
+    }
+    mpu.calibrate();
+
+    // 1 kHz accel/gyro into the FIFO
+    mpu.setOutputDataRate(GYRO_DLPF_184HZ, ACCEL_DLPF_184HZ, 0);
+
+    ULN2003Stepper stepper(IN1, IN2, IN3, IN4);
+    stepper.setSpeed(15);
+
+    Reactor reactor;
+    if (!reactor.ok()) {
+        return -1;
+    }
+    g_reactor = &reactor;
+    signal(SIGINT, onSignal);
+
+    AsyncMPU9250 imu(reactor, mpu, 10000);
+    Decimator decimator(50, mpu.getAccelSampleRate());
+    reactor.spawn(readImu(imu, decimator));
+    reactor.spawn(spinMotor(reactor, stepper));
+
+    std::cout << "Press Ctrl+C to stop." << std::endl;
+    reactor.run();
+
+    stepper.stop();
+    return 0;
+}
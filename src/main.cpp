@@ -1,6 +1,7 @@
 #include <iostream>
 #include <iomanip> // For std::fixed and std::setprecision
 #include "MPU9250.h"
+#include "Realtime.h"
 #include <wiringPi.h>
 
 int main(void) {
@@ -18,6 +19,12 @@ int main(void) {
     // Keep the sensor level and motionless during this process
     mpu.calibrate();
 
+    // Run the acquisition loop with real-time priority when permitted
+    RealtimeConfig rt;
+    setupRealtime(rt);
+    PeriodicTimer loopTimer(50000);
+    loopTimer.start();
+
     // Main loop to read and display data
     while (1) {
         // Read the latest data from all sensors
@@ -47,10 +54,16 @@ int main(void) {
         // Print Temperature
         std::cout << "Temp  [C]:  " << mpu.temperature << std::endl;
 
+        // Print loop timing
+        const TimingStats& stats = loopTimer.getStats();
+        std::cout << "Loop  [us]: latency=" << stats.meanLatencyUs() << " | "
+                  << "max=" << stats.maxLatencyUs << " | "
+                  << "overruns=" << stats.overruns << std::endl;
+
         std::cout << "--------------------------------------------------" << std::endl;
 
-        // Delay for 500 milliseconds (2 Hz update rate)
-        delay(50);
+        // Wait for the next 50 millisecond deadline (20 Hz update rate)
+        loopTimer.wait();
     }
 
     return 0;
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip> // For std::fixed and std::setprecision
+#include <cmath>
+#include <wiringPi.h>
+#include "MPU9250.h"
+#include "MotionSimulator.h"
+#include "SimulatedMPU9250.h"
+
+// Runs the driver against SimulatedMPU9250 on both buses, in real time, and checks
+// that update() takes every magnetometer sample its loop rate allows and counts
+// the ones it misses.
+// Usage: simulated_bus_check [seconds_per_run]
+
+static bool runCheck(Bus bus, uint32_t loopUs, float seconds) {
+    const float z[3] = {0, 0, 1};
+    MotionSimulator sim(200.0f); // The driver's default 200 Hz, +/-2 g, 250 dps, 16-bit
+    sim.addStill(0.5f);
+    sim.addRotation(2.0f, z, 45.0f);
+    sim.setLoop(true);
+
+    SimulatedMPU9250 device(sim);
+    MPU9250 mpu;
+    mpu.setTransport(&device);
+    if (!mpu.init(AFS_2G, GFS_250DPS, MFS_16BITS, M_100Hz_CONTINUOUS, bus)) {
+        std::cerr << "Failed to initialize the simulated MPU9250." << std::endl;
+        return false;
+    }
+
+    uint64_t magStart = device.getMagSampleCount();
+    int updates = 0, fresh = 0, stalls = 0;
+    float fieldMin = INFINITY, fieldMax = 0.0f;
+    uint32_t start = micros();
+    uint32_t last = start;
+    while (micros() - start < (uint32_t)(seconds * 1e6f)) {
+        mpu.update();
+        updates++;
+
+        // The host not running us for longer than the loop plus a magnetometer period
+        // costs samples no driver could take
+        uint32_t now = micros();
+        if (now - last > loopUs + 10000) {
+            stalls += (now - last - loopUs) / 10000;
+        }
+        last = now;
+        if (mpu.magFresh) {
+            fresh++;
+            float field = sqrtf(mpu.mx * mpu.mx + mpu.my * mpu.my + mpu.mz * mpu.mz);
+            if (field < fieldMin) fieldMin = field;
+            if (field > fieldMax) fieldMax = field;
+        }
+        delayMicroseconds(loopUs);
+    }
+    uint64_t produced = device.getMagSampleCount() - magStart;
+
+    // Each update can take at most one sample; a slower loop skips the rest on purpose.
+    // Only the first update may come up empty, before the first measurement is ready.
+    uint64_t expected = (produced < (uint64_t)updates) ? produced : (uint64_t)updates;
+    bool ok = fresh + 1 + stalls >= (int)expected && fieldMin > 400.0f && fieldMax < 500.0f;
+
+    // A loop slower than the sensor misses samples before nearly every one it takes;
+    // a faster one should miss no more than it failed to take
+    if (produced > (uint64_t)updates) {
+        ok = ok && (int)mpu.magMissedCount + 2 >= fresh;
+    } else {
+        ok = ok && (int)mpu.magMissedCount <= (int)expected - fresh + 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << ((bus == BUS_SPI) ? "SPI" : "I2C") << ", " << loopUs / 1000.0f << " ms loop: "
+              << fresh << " fresh of " << expected << " takeable (" << produced << " produced, "
+              << updates << " updates), |B| " << fieldMin << "-" << fieldMax << " mG, "
+              << mpu.magMissedCount << " overruns";
+    if (stalls > 0) {
+        std::cout << ", " << stalls << " lost to host stalls";
+    }
+    std::cout << " -> " << (ok ? "OK" : "FAIL") << std::endl;
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    float seconds = (argc > 1) ? atof(argv[1]) : 2.0f;
+
+    bool ok = true;
+    ok &= runCheck(BUS_I2C, 50000, seconds);
+    ok &= runCheck(BUS_I2C, 2000, seconds);
+    ok &= runCheck(BUS_SPI, 50000, seconds);
+    ok &= runCheck(BUS_SPI, 2000, seconds);
+
+    return ok ? 0 : 1;
+}
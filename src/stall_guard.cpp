@@ -0,0 +1,127 @@
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <wiringPi.h>
+#include "MPU9250.h"
+#include "Stepper.h"
+#include "StallMonitor.h"
+#include "Realtime.h"
+
+#define IN1 0   //Board pin 11
+#define IN2 2   //Board pin 13
+#define IN3 3   //Board pin 15
+#define IN4 4   //Board pin 16
+
+// Ramps a stepper up one RPM per revolution until the IMU on the driven
+// mechanism sees it stall, then backs the speed off and resyncs the position.
+// Mount the MPU9250 on the turning part with its Z axis along the shaft.
+//
+// The IMU is sampled on its own thread at a fixed rate, independent of the
+// step phase; the step listener only records steps, so no bus traffic delays
+// the step deadlines.
+
+static const int GYRO_AXIS = 2;
+static const uint32_t SAMPLE_PERIOD_US = 2000; // 500 Hz, within reach of a gyro-only read on I2C
+
+struct Guard {
+    MPU9250* mpu;
+    StallMonitor* monitor;
+    std::mutex lock;
+    std::atomic<bool> running{true};
+};
+
+// Records each step and stops the move as soon as the sampler has seen a stall
+static bool onStep(int direction, void* context) {
+    Guard* guard = (Guard*)context;
+    std::lock_guard<std::mutex> hold(guard->lock);
+    guard->monitor->onStep(direction, micros());
+    return guard->monitor->getState() != STALL_STALLED;
+}
+
+// Feeds the monitor from the gyro at a steady rate, moving or not, so moves end
+// and the gyro bias is learned between them
+static void sampleImu(Guard* guard) {
+    RealtimeConfig rt;
+    rt.cpu = 2;
+    rt.priority = 70;
+    setupRealtime(rt);
+
+    PeriodicTimer timer(SAMPLE_PERIOD_US);
+    timer.start();
+    while (guard->running) {
+        guard->mpu->updateRaw();
+        float gyro[3] = {0, 0, 0};
+        gyro[GYRO_AXIS] = guard->mpu->gyroDps(GYRO_AXIS);
+        uint32_t now = micros();
+        {
+            std::lock_guard<std::mutex> hold(guard->lock);
+            guard->monitor->update(gyro, nullptr, now);
+        }
+        timer.wait();
+    }
+}
+
+int main() {
+    MPU9250 mpu;
+    if (!mpu.init(AFS_2G, GFS_250DPS)) {
+        std::cerr << "Failed to initialize MPU9250." << std::endl;
+        return -1;
+    }
+    // Keep the mechanism still while calibrating
+    mpu.calibrate();
+
+    // 1 kHz with a wide gyro bandwidth so the filter delay stays well inside the
+    // stall window; only the gyro is read
+    mpu.setOutputDataRate(GYRO_DLPF_184HZ, ACCEL_DLPF_184HZ, 0);
+    mpu.setChannelRates(-1, 0, -1, -1);
+
+    ULN2003Stepper stepper(IN1, IN2, IN3, IN4);
+    StallMonitor monitor(360.0f / 2048.0f, GYRO_AXIS);
+    Guard guard;
+    guard.mpu = &mpu;
+    guard.monitor = &monitor;
+    stepper.setStepListener(onStep, &guard);
+
+    std::thread sampler(sampleImu, &guard);
+    delay(1000); // Learn the gyro bias before the first move
+
+    RealtimeConfig rt;
+    rt.cpu = 3;
+    setupRealtime(rt);
+
+    long rpm = 10;
+    uint64_t overruns = 0;
+    while (true) {
+        stepper.setSpeed(rpm);
+        int taken = stepper.step(2048);
+        delay(100); // Let the move end and the mechanism settle
+
+        // Late steps mean the motor never ran at the requested speed
+        uint64_t late = stepper.getTimingStats().overruns - overruns;
+        overruns = stepper.getTimingStats().overruns;
+
+        std::lock_guard<std::mutex> hold(guard.lock);
+        long lost = monitor.getLostSteps();
+        if (monitor.getState() == STALL_STALLED || monitor.getState() == STALL_LOST_STEPS) {
+            // The motor fell behind its commanded position: resync it and slow down
+            stepper.setPosition(stepper.getPosition() - lost);
+            std::cout << "Stall at " << rpm << " RPM after " << taken << " steps, "
+                      << lost << " steps lost, " << late << " late steps" << std::endl;
+            rpm = (rpm > 2) ? rpm - 2 : 1;
+            monitor.reset();
+        } else if (late > 0) {
+            std::cout << "Revolution at " << rpm << " RPM not judged: " << late
+                      << " late steps" << std::endl;
+        } else {
+            std::cout << "Revolution at " << rpm << " RPM ok (tracking "
+                      << monitor.getTrackingRatio() << ")" << std::endl;
+            rpm++;
+        }
+    }
+    guard.running = false;
+    sampler.join();
+    stepper.stop();
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <iomanip> // For std::fixed and std::setprecision
+#include <cmath>
+#include "TempCompensation.h"
+
+// Feeds TempCompensation stationary windows with a known bias and checks what it
+// looks up: the measured bias wherever a single temperature was learned, and the
+// line through two learned temperatures between and at them.
+
+static void feed(TempCompensation& model, const float gyroBias[3], float temperature) {
+    const float accel[3] = {0.02f, -0.01f, 1.0f};
+    for (int i = 0; i < model.windowSamples; i++) {
+        model.learn(accel, gyroBias, temperature);
+    }
+}
+
+static bool expectBias(const TempCompensation& model, float temperature, const float expected[3]) {
+    float accelBias[3], gyroBias[3];
+    bool ok = model.getBias(temperature, accelBias, gyroBias);
+    for (int i = 0; i < 3 && ok; i++) {
+        ok = fabsf(gyroBias[i] - expected[i]) <= 0.01f * fabsf(expected[i]) + 1e-4f;
+    }
+    ok = ok && fabsf(accelBias[0] - 0.02f) < 1e-4f && fabsf(accelBias[2]) < 1e-4f;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  " << temperature << " C: gyro bias " << gyroBias[0] << ", " << gyroBias[1]
+              << ", " << gyroBias[2] << " dps -> " << (ok ? "OK" : "FAIL") << std::endl;
+    return ok;
+}
+
+int main() {
+    const float bias[3] = {1.0f, -0.5f, 2.0f};
+    bool ok = true;
+
+    // Learned at one temperature, on and off the grid nodes
+    for (float learned : {25.0f, 28.5f, 26.0f, 29.0f}) {
+        TempCompensation model;
+        feed(model, bias, learned);
+        std::cout << "Learned at " << learned << " C:" << std::endl;
+        for (float t : {learned, 10.0f, 40.0f}) {
+            ok &= expectBias(model, t, bias);
+        }
+    }
+
+    // Learned at two temperatures: a linear drift of 0.1 dps/C on every axis
+    TempCompensation model;
+    model.maxBiasJumpDps = 5.0f;
+    const float atLow[3] = {1.0f, -0.5f, 2.0f};
+    const float atHigh[3] = {2.5f, 1.0f, 3.5f};
+    feed(model, atLow, 22.0f);
+    feed(model, atHigh, 37.0f);
+    std::cout << "Learned at 22 C and 37 C:" << std::endl;
+    for (float t : {22.0f, 29.5f, 37.0f}) {
+        float f = (t - 22.0f) / 15.0f;
+        float expected[3];
+        for (int i = 0; i < 3; i++) {
+            expected[i] = atLow[i] + f * (atHigh[i] - atLow[i]);
+        }
+        ok &= expectBias(model, t, expected);
+    }
+
+    std::cout << (ok ? "All checks passed." : "Checks FAILED.") << std::endl;
+    return ok ? 0 : 1;
+}